@@ -0,0 +1,357 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#define MEMALLOC_CATEGORY   MEMCAT_CODE
+
+#include "logger.h"
+#include "slang.h"
+#include "memalloc.h"
+#include "bytecode.h"
+
+#include <string.h>
+
+typedef struct _BC_BUILDER
+{
+    BYTECODE*   bytecode;
+    int         size;
+    int         depth;      /* foreach nesting while lowering */
+}
+BC_BUILDER;
+
+int bc_emit( BC_BUILDER* builder , int op , CODE* code )
+{
+    BYTECODE*   bytecode = builder->bytecode;
+    BC_INSTR*   instr;
+    
+    if ( bytecode->count >= builder->size )
+    {
+        builder->size = MAX( builder->size * 2 , 16 );
+        instr = memalloc_zero( sizeof( BC_INSTR ) * builder->size );
+        
+        if ( bytecode->instr != NULL )
+        {
+            memcpy(
+                instr ,
+                bytecode->instr ,
+                sizeof( BC_INSTR ) * bytecode->count
+            );
+            memfree( bytecode->instr );
+        }
+        
+        bytecode->instr = instr;
+    }
+    
+    instr = &(bytecode->instr[bytecode->count]);
+    memset( instr , 0 , sizeof( BC_INSTR ) );
+    instr->op = op;
+    instr->code = code;
+    
+    if ( code != NULL )
+    {
+        instr->value = code->value;
+    }
+    
+    return bytecode->count++;
+}
+
+void bc_fail( BC_BUILDER* builder , CODE* code , int line )
+{
+    int pc;
+    
+    pc = bc_emit( builder , BC_FAIL , code );
+    builder->bytecode->instr[pc].a = line;
+}
+
+int bc_lower_code( BC_BUILDER* builder , CODE* code );
+
+int bc_lower_equ( BC_BUILDER* builder , CODE* code )
+{
+    CODE_VALUE* val_array = code->value;
+    int         pc;
+    
+    if ( val_array[0].type != CVT_VARIABLE )
+    {
+        bc_fail( builder , code , __LINE__ );
+        return 1;
+    }
+    
+    if ( val_array[1].type == CVT_VARIABLE )
+    {
+        pc = bc_emit( builder , BC_MOVE , code );
+        builder->bytecode->instr[pc].b = val_array[1].index;
+    }
+    else if ( val_array[1].type == CVT_CONST )
+    {
+        pc = bc_emit( builder , BC_LOADK , code );
+        builder->bytecode->instr[pc].value = &(val_array[1]);
+    }
+    else if ( val_array[1].type == CVT_INIT )
+    {
+        pc = bc_emit( builder , BC_CLEAR , code );
+    }
+    else
+    {
+        return 1;
+    }
+    
+    builder->bytecode->instr[pc].a = val_array[0].index;
+    return 1;
+}
+
+int bc_lower_if( BC_BUILDER* builder , CODE* code )
+{
+    CODE_VALUE* val_array = code->value;
+    CODE_VALUE* valueptr;
+    BC_INSTR*   instr;
+    int         i;
+    int         pc;
+    int         pcfalse;
+    int         pcend;
+    
+    i = 0;
+    pcend = -1;     /* chain of jumps to the end, linked through c */
+    
+    while ( i < code->val_array_count )
+    {
+        valueptr = &(val_array[i]);
+        
+        if ( valueptr->type == CVT_CODE )
+        {
+            /* else */
+            if ( ! bc_lower_code( builder , valueptr->data ) )
+            {
+                return 0;
+            }
+            
+            break;
+        }
+        
+        i++;
+        
+        if ( ( i >= code->val_array_count )
+            || ( val_array[i].type != CVT_CODE ) )
+        {
+            bc_fail( builder , code , __LINE__ );
+            break;
+        }
+        
+        pcfalse = bc_emit( builder , BC_JUMPFALSE , code );
+        builder->bytecode->instr[pcfalse].value = valueptr;
+        
+        if ( ! bc_lower_code( builder , val_array[i].data ) )
+        {
+            return 0;
+        }
+        
+        pc = bc_emit( builder , BC_JUMP , code );
+        builder->bytecode->instr[pc].c = pcend;
+        pcend = pc;
+        builder->bytecode->instr[pcfalse].c = builder->bytecode->count;
+        i++;
+    }
+    
+    while ( pcend >= 0 )
+    {
+        instr = &(builder->bytecode->instr[pcend]);
+        pcend = instr->c;
+        instr->c = builder->bytecode->count;
+    }
+    
+    return 1;
+}
+
+int bc_lower_while( BC_BUILDER* builder , CODE* code )
+{
+    CODE_VALUE* val_array = code->value;
+    int         pc;
+    int         pcfalse;
+    
+    if ( val_array[1].type != CVT_CODE )
+    {
+        bc_fail( builder , code , __LINE__ );
+        return 1;
+    }
+    
+    pcfalse = bc_emit( builder , BC_JUMPFALSE , code );
+    builder->bytecode->instr[pcfalse].value = &(val_array[0]);
+    builder->bytecode->instr[pcfalse].b = 1;
+    
+    if ( ! bc_lower_code( builder , val_array[1].data ) )
+    {
+        return 0;
+    }
+    
+    pc = bc_emit( builder , BC_JUMP , code );
+    builder->bytecode->instr[pc].c = pcfalse;
+    builder->bytecode->instr[pcfalse].c = builder->bytecode->count;
+    return 1;
+}
+
+int bc_lower_foreach( BC_BUILDER* builder , CODE* code )
+{
+    CODE_VALUE* val_array = code->value;
+    int         count = code->val_array_count;
+    int         pc;
+    int         pcnext;
+    int         state;
+    
+    if ( ( count < 3 )
+        || ( val_array[count - 1].type != CVT_CODE )
+        || ( val_array[0].type != CVT_VARIABLE )
+        || ( ( count >= 4 ) && ( val_array[1].type != CVT_VARIABLE ) )
+        || ( ( count == 5 ) && ( val_array[2].type != CVT_CONST ) ) )
+    {
+        bc_fail( builder , code , __LINE__ );
+        return 1;
+    }
+    
+    state = builder->depth++;
+    
+    if ( builder->depth > builder->bytecode->foreach_depth )
+    {
+        builder->bytecode->foreach_depth = builder->depth;
+    }
+    
+    pc = bc_emit( builder , BC_FOREACH , code );
+    builder->bytecode->instr[pc].a = state;
+    
+    pcnext = bc_emit( builder , BC_FOREACHNEXT , code );
+    builder->bytecode->instr[pcnext].a = state;
+    
+    if ( ! bc_lower_code( builder , val_array[count - 1].data ) )
+    {
+        return 0;
+    }
+    
+    pc = bc_emit( builder , BC_JUMP , code );
+    builder->bytecode->instr[pc].c = pcnext;
+    builder->bytecode->instr[pcnext].c = builder->bytecode->count;
+    builder->depth--;
+    return 1;
+}
+
+int bc_lower_code( BC_BUILDER* builder , CODE* code )
+{
+    SLINT ret = 1;
+    int   pc;
+    
+    while ( code )
+    {
+        switch ( code->op )
+        {
+        case OP_EQU:
+            ret = bc_lower_equ( builder , code );
+            break;
+        case OP_EVALUATE:
+            bc_emit( builder , BC_EVALUATE , code );
+            break;
+        case OP_STRFORMAT:
+            bc_emit( builder , BC_STRFORMAT , code );
+            break;
+        case OP_IF:
+            ret = bc_lower_if( builder , code );
+            break;
+        case OP_WHILE:
+            ret = bc_lower_while( builder , code );
+            break;
+        case OP_RETURN:
+            bc_emit( builder , BC_RETURN , code );
+            break;
+        case OP_CALL:
+            pc = bc_emit( builder , BC_CALL , code );
+            
+            if ( ( code->value != NULL )
+                && ( code->value[0].type == CVT_CONST ) )
+            {
+                builder->bytecode->instr[pc].a =
+                    builder->bytecode->call_cache_count++;
+            }
+            else
+            {
+                builder->bytecode->instr[pc].a = -1;
+            }
+            
+            break;
+        case OP_GETITEMCOUNT:
+            bc_emit( builder , BC_GETITEMCOUNT , code );
+            break;
+        case OP_GETITEM:
+            bc_emit( builder , BC_GETITEM , code );
+            break;
+        case OP_SETITEM:
+            bc_emit( builder , BC_SETITEM , code );
+            break;
+        case OP_FOREACH:
+            ret = bc_lower_foreach( builder , code );
+            break;
+        case OP_NOOP:
+            break;
+        default:
+            break;
+        }
+        
+        if ( ! ret )
+        {
+            return 0;
+        }
+        
+        code = code->next;
+    }
+    
+    return 1;
+}
+
+BYTECODE* compile_bytecode( CODE* code )
+{
+    BC_BUILDER  builder;
+    
+    memset( &builder , 0 , sizeof( BC_BUILDER ) );
+    builder.bytecode = memalloc_zero( sizeof( BYTECODE ) );
+    
+    if ( ! bc_lower_code( &builder , code ) )
+    {
+        free_bytecode( builder.bytecode );
+        return NULL;
+    }
+    
+    bc_emit( &builder , BC_END , NULL );
+    
+    if ( builder.bytecode->call_cache_count > 0 )
+    {
+        builder.bytecode->call_cache = memalloc_zero(
+            sizeof( CALL_CACHE ) * builder.bytecode->call_cache_count
+        );
+    }
+    
+    return builder.bytecode;
+}
+
+void free_bytecode( BYTECODE* bytecode )
+{
+    if ( bytecode != NULL )
+    {
+        if ( bytecode->instr != NULL )
+        {
+            memfree( bytecode->instr );
+        }
+        
+        if ( bytecode->call_cache != NULL )
+        {
+            memfree( bytecode->call_cache );
+        }
+        
+        memfree( bytecode );
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#ifndef __LOADER_BYTECODE_H_INCLUDED__
+#define __LOADER_BYTECODE_H_INCLUDED__
+
+#include "slang.h"
+#include "run.h"
+
+/* use computed goto for the dispatch loop where the compiler has it */
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) \
+    && ! defined( BC_NO_COMPUTED_GOTO )
+    #define BC_COMPUTED_GOTO
+#endif
+
+enum BYTECODE_OP
+{
+    BC_END                  = 0  ,  /* leave the node body */
+    BC_MOVE                 = 1  ,  /* a = b */
+    BC_LOADK                = 2  ,  /* a = const value */
+    BC_CLEAR                = 3  ,  /* a = NULL */
+    BC_EVALUATE             = 4  ,  /* run_eval( code ) */
+    BC_STRFORMAT            = 5  ,  /* run_format( code ) */
+    BC_RETURN               = 6  ,  /* run_return( code ) */
+    BC_CALL                 = 7  ,  /* run_call( code ) */
+                                    /* a: call cache slot or -1 */
+    BC_GETITEMCOUNT         = 8  ,  /* run_getitemcount( code ) */
+    BC_GETITEM              = 9  ,  /* run_getitem( code ) */
+    BC_SETITEM              = 10 ,  /* run_setitem( code ) */
+    BC_JUMP                 = 11 ,  /* goto c */
+    BC_JUMPFALSE            = 12 ,  /* if ( ! value ) goto c */
+                                    /* b: evaluate failure is an error */
+    BC_FOREACH              = 13 ,  /* start iterating code into state a */
+    BC_FOREACHNEXT          = 14 ,  /* next item of state a, */
+                                    /* goto c when done */
+    BC_FAIL                 = 15 ,  /* malformed statement, errorno a */
+    BC_OP_COUNT             = 16
+};
+
+typedef struct _BC_INSTR    BC_INSTR;
+
+struct _BC_INSTR
+{
+    int                     op;     /* BYTECODE_OP */
+    int                     a;
+    int                     b;
+    int                     c;
+    CODE_VALUE*             value;
+    CODE*                   code;
+};
+
+struct _BYTECODE
+{
+    BC_INSTR*               instr;
+    int                     count;
+    int                     foreach_depth;  /* nested foreach states */
+    CALL_CACHE*             call_cache;     /* constant-name call sites */
+    int                     call_cache_count;
+};
+
+BYTECODE* compile_bytecode( CODE* code );
+
+void free_bytecode( BYTECODE* bytecode );
+
+#endif
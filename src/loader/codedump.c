@@ -16,8 +16,11 @@
 #include <string.h>
 
 #include "logger.h"
+#include "memalloc.h"
+#include "map_flat.h"
 #include "slang.h"
 #include "file.h"
+#include "eval.h"
 //#include "run.h"
 
 int get_value_count( CODE_VALUE* value )
@@ -81,21 +84,11 @@ void dump_value( CODE_VALUE* value , FILE_DESC* pf )
         }
         else if ( value->type == CVT_EVAL )
         {
-            if ( value->data == NULL )
-            {
-                temp = 0;
-            }
-            else
-            {
-                temp = strlen( ( char* )value->data );
-            }
-            
-            filewrite( pf , &temp , INT_SIZE );
-            
-            if ( temp > 0 )
-            {
-                filewrite( pf , value->data , temp );
-            }
+            dump_evaluate( value->data , pf );
+        }
+        else if ( value->type == CVT_FORMAT )
+        {
+            dump_strformat( value->data , pf );
         }
         
         value = value->next;
@@ -147,28 +140,27 @@ void dump_value_array( CODE_VALUE* value , int count , FILE_DESC* pf )
         }
         else if ( value->type == CVT_EVAL )
         {
-            if ( value->data == NULL )
-            {
-                temp = 0;
-            }
-            else
-            {
-                temp = strlen( ( char* )value->data );
-            }
-            
-            filewrite( pf , &temp , INT_SIZE );
-            
-            if ( temp > 0 )
-            {
-                filewrite( pf , value->data , temp );
-            }
+            dump_evaluate( value->data , pf );
+        }
+        else if ( value->type == CVT_FORMAT )
+        {
+            dump_strformat( value->data , pf );
         }
         
         value++;
     }
 }
 
-void dump_param( NODE_PARAM* param , FILE_DESC* pf )
+/* the id of name in the table at the head of the file */
+void dump_name( HFMAP names , char* name , FILE_DESC* pf )
+{
+    int id;
+    
+    id = ( int )fmap_query64( names , name ) - 1;
+    filewrite( pf , &id , INT_SIZE );
+}
+
+void dump_param( NODE_PARAM* param , HFMAP names , FILE_DESC* pf )
 {
     int i;
     
@@ -180,11 +172,75 @@ void dump_param( NODE_PARAM* param , FILE_DESC* pf )
     {
         for ( i = 0; i < param->count; i++ )
         {
-            filewrite( pf , &param->list[i].name , MAX_NAME_LEN );
+            dump_name( names , param->list[i].name , pf );
         }
     }
 }
 
+static void add_name( HFMAP names , char*** list , int* count , char* name )
+{
+    char**  grown;
+    
+    if ( fmap_query64( names , name ) != 0 )
+    {
+        return;
+    }
+    
+    grown = memalloc( sizeof( char* ) * ( *count + 1 ) );
+    
+    if ( *count > 0 )
+    {
+        memcpy( grown , *list , sizeof( char* ) * ( *count ) );
+    }
+    
+    memfree( *list );
+    *list = grown;
+    ( *list )[ ( *count )++ ] = name;
+    fmap_insert64( names , name , *count );
+}
+
+/* every node and param name once, the nodes refer to them by index */
+static HFMAP dump_names( NODE* node , FILE_DESC* pf )
+{
+    HFMAP   names;
+    char**  list = NULL;
+    int     count = 0;
+    int     len;
+    int     i;
+    
+    names = fmap_init( 64 );
+    
+    for ( ; node != NULL; node = node->next )
+    {
+        if ( ( node->type != NT_SCNODE ) && ( node->type != NT_FISSIONNODE ) )
+        {
+            continue;
+        }
+        
+        add_name( names , &list , &count , node->name );
+        
+        if ( node->param != NULL )
+        {
+            for ( i = 0; i < node->param->count; i++ )
+            {
+                add_name( names , &list , &count , node->param->list[i].name );
+            }
+        }
+    }
+    
+    filewrite( pf , &count , INT_SIZE );
+    
+    for ( i = 0; i < count; i++ )
+    {
+        len = strlen( list[i] );
+        filewrite( pf , &len , INT_SIZE );
+        filewrite( pf , list[i] , len );
+    }
+    
+    memfree( list );
+    return names;
+}
+
 int dump_code( CODE* code , FILE_DESC* pf )
 {
     CODE*   temp;
@@ -266,6 +322,7 @@ int dump_node( NODE* node , char* dest_file )
     int     empty;
     NODE*   nodehead;
     NODE*   temp;
+    HFMAP   names;
     
     count = 0;
     
@@ -276,6 +333,13 @@ int dump_node( NODE* node , char* dest_file )
         return 0;
     }
     
+    count = CODE_MAGIC;
+    filewrite( pf , &count , INT_SIZE );
+    count = CODE_VERSION;
+    filewrite( pf , &count , INT_SIZE );
+    names = dump_names( node , pf );
+    
+    count = 0;
     nodehead = node;
     temp = nodehead;
     
@@ -298,11 +362,11 @@ int dump_node( NODE* node , char* dest_file )
         if ( ( node->type == NT_SCNODE ) || ( node->type == NT_FISSIONNODE ) )
         {
             filewrite( pf , &node->type , INT_SIZE );
-            filewrite( pf , node->name , MAX_WORD_NAME_LEN );
+            dump_name( names , node->name , pf );
             
             if ( node->param != NULL )
             {
-                dump_param( node->param , pf );
+                dump_param( node->param , names , pf );
             }
             else
             {
@@ -339,17 +403,19 @@ int dump_node( NODE* node , char* dest_file )
                 
                 if ( !temp )
                 {
+                    fmap_release( names , NULL , NULL );
                     fileclose( pf );
                     return 0;
                 }
                 
-                filewrite( pf , temp->name , MAX_WORD_NAME_LEN );
+                dump_name( names , temp->name , pf );
             }
         }
         
         node = node->next;
     }
     
+    fmap_release( names , NULL , NULL );
     fileclose( pf );
     return 1;
 }
@@ -18,6 +18,8 @@
 #include "map.h"
 #include "mem.h"
 #include "memalloc.h"
+#include "bytecode.h"
+#include "eval.h"
 
 void free_code( CODE* code );
 
@@ -42,7 +44,11 @@ void free_value( CODE_VALUE* value )
             }
             else if ( temp->type == CVT_EVAL )
             {
-                memfree( temp->data );
+                free_eval_prog( temp->data );
+            }
+            else if ( temp->type == CVT_FORMAT )
+            {
+                free_strformat( temp->data );
             }
         }
         
@@ -68,7 +74,11 @@ void free_value_array( CODE_VALUE* value , int count )
             }
             else if ( value[i].type == CVT_EVAL )
             {
-                memfree( value[i].data );
+                free_eval_prog( value[i].data );
+            }
+            else if ( value[i].type == CVT_FORMAT )
+            {
+                free_strformat( value[i].data );
             }
         }
     }
@@ -145,6 +155,7 @@ void free_body( NODE_BODY* body )
         free_code( body->code );
     }
     
+    free_bytecode( body->bytecode );
     memfree( body );
 }
 
@@ -174,6 +185,52 @@ void free_node( NODE* node )
     }
 }
 
+/* values the constants of code handed out while it ran */
+static void free_code_data( RUNTIME* runtime , CODE* code )
+{
+    CODE_VALUE* value;
+    int         i;
+    
+    for ( ; code != NULL; code = code->next )
+    {
+        if ( code->value == NULL )
+        {
+            continue;
+        }
+        
+        if ( code->val_array_count >= 0 )
+        {
+            for ( i = 0; i < code->val_array_count; i++ )
+            {
+                value = &code->value[i];
+                
+                if ( value->type == CVT_CONST )
+                {
+                    unref_value_const( runtime , value );
+                }
+                else if ( ( value->type == CVT_CODE ) && value->data )
+                {
+                    free_code_data( runtime , value->data );
+                }
+            }
+        }
+        else
+        {
+            for ( value = code->value; value != NULL; value = value->next )
+            {
+                if ( value->type == CVT_CONST )
+                {
+                    unref_value_const( runtime , value );
+                }
+                else if ( ( value->type == CVT_CODE ) && value->data )
+                {
+                    free_code_data( runtime , value->data );
+                }
+            }
+        }
+    }
+}
+
 void free_node_data( RUNTIME* runtime , NODE* node )
 {
     NODE*   temp;
@@ -183,6 +240,12 @@ void free_node_data( RUNTIME* runtime , NODE* node )
         temp = node;
         node = node->next;
         
+        /* a fission node shares its body with the node it came from */
+        if ( ( temp->type == NT_SCNODE ) && ( temp->body != NULL ) )
+        {
+            free_code_data( runtime , temp->body->code );
+        }
+        
         if ( temp->param != NULL )
         {
             if ( temp->param->list != NULL )
@@ -13,11 +13,14 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  * */
 
+#define MEMALLOC_CATEGORY   MEMCAT_CODE
+
 #include <string.h>
 
 #include "logger.h"
 #include "slang.h"
 #include "memalloc.h"
+#include "eval.h"
 
 void free_value( CODE_VALUE* value );
 
@@ -101,21 +104,20 @@ CODE_VALUE* load_value( FILE_DESC* pf , int* pcount , int* haverror )
         }
         else if ( value->type == CVT_EVAL )
         {
-            if ( fileread( pf , &temp , INT_SIZE ) != INT_SIZE )
+            value->data = load_evaluate( pf , haverror );
+            
+            if ( *haverror )
             {
-                *haverror = 1;
                 break;
             }
+        }
+        else if ( value->type == CVT_FORMAT )
+        {
+            value->data = load_strformat( pf , haverror );
             
-            if ( temp > 0 )
+            if ( *haverror )
             {
-                value->data = memalloc_zero( temp + 1 );
-                
-                if ( fileread( pf , value->data , temp ) != temp )
-                {
-                    *haverror = 1;
-                    break;
-                }
+                break;
             }
         }
     }
@@ -203,7 +205,64 @@ int load_body( NODE_BODY* body , FILE_DESC* pf )
     return 1;
 }
 
-int load_param( NODE_PARAM* param , FILE_DESC* pf )
+/* a name id read from the file, NULL when it is out of the table */
+char* load_name( char** names , int count , FILE_DESC* pf )
+{
+    int id;
+    
+    if ( fileread( pf , &id , INT_SIZE ) != INT_SIZE )
+    {
+        return NULL;
+    }
+    
+    if ( ( id < 0 ) || ( id >= count ) )
+    {
+        return NULL;
+    }
+    
+    return names[id];
+}
+
+/* the name table at the head of the file, count is -1 on a read error */
+char** load_names( FILE_DESC* pf , int* count )
+{
+    char**  names;
+    char    name[MAX_NAME_LEN];
+    int     len;
+    int     i;
+    
+    if ( ( fileread( pf , count , INT_SIZE ) != INT_SIZE ) || ( *count < 0 ) )
+    {
+        *count = -1;
+        return NULL;
+    }
+    
+    if ( *count == 0 )
+    {
+        return NULL;
+    }
+    
+    names = memalloc_zero( sizeof( char* ) * ( *count ) );
+    
+    for ( i = 0; i < *count; i++ )
+    {
+        if ( ( fileread( pf , &len , INT_SIZE ) != INT_SIZE )
+            || ( len <= 0 )
+            || ( len >= MAX_NAME_LEN )
+            || ( fileread( pf , name , len ) != len ) )
+        {
+            memfree( names );
+            *count = -1;
+            return NULL;
+        }
+        
+        names[i] = intern_name( name , len );
+    }
+    
+    return names;
+}
+
+int load_param( NODE_PARAM* param , char** names , int namecount , FILE_DESC* pf )
 {
     int i;
     
@@ -232,12 +291,9 @@ int load_param( NODE_PARAM* param , FILE_DESC* pf )
     for ( i = 0; i < param->count; i++ )
     {
         param->list[i].value = NULL;
+        param->list[i].name = load_name( names , namecount , pf );
         
-        if ( fileread(
-            pf                      ,
-            &param->list[i].name    ,
-            MAX_NAME_LEN
-        ) != MAX_NAME_LEN )
+        if ( param->list[i].name == NULL )
         {
             return 0;
         }
@@ -255,7 +311,9 @@ NODE* load_node( char* bin_file )
     int         count;
     int         i;
     int         readok;
-    char        fname[MAX_WORD_NAME_LEN];
+    char*       fname;
+    char**      names;
+    int         namecount;
     
     count   = 0;
     ret     = NULL;
@@ -269,14 +327,23 @@ NODE* load_node( char* bin_file )
         return NULL;
     }
     
-    if ( fileread( pf , &count , INT_SIZE ) != INT_SIZE )
+    if ( ( fileread( pf , &count , INT_SIZE ) != INT_SIZE )
+        || ( count != CODE_MAGIC )
+        || ( fileread( pf , &count , INT_SIZE ) != INT_SIZE )
+        || ( count != CODE_VERSION ) )
     {
+        log_info( "%s is not a version %d code file" , bin_file , CODE_VERSION );
         fileclose( pf );
         return NULL;
     }
     
-    if ( count == 0 )
+    names = load_names( pf , &namecount );
+    
+    if ( ( namecount < 0 )
+        || ( fileread( pf , &count , INT_SIZE ) != INT_SIZE )
+        || ( count == 0 ) )
     {
+        memfree( names );
         fileclose( pf );
         return NULL;
     }
@@ -301,11 +368,9 @@ NODE* load_node( char* bin_file )
             break;
         }
         
-        if ( fileread(
-            pf                  ,
-            node->name          ,
-            MAX_WORD_NAME_LEN
-        ) != MAX_WORD_NAME_LEN )
+        node->name = load_name( names , namecount , pf );
+        
+        if ( node->name == NULL )
         {
             log_info( "error 1" );
             readok = 0;
@@ -315,7 +380,7 @@ NODE* load_node( char* bin_file )
         /*read param*/
         node->param = memalloc_zero( sizeof( NODE_PARAM ) );
         
-        if ( !load_param( node->param , pf ) )
+        if ( !load_param( node->param , names , namecount , pf ) )
         {
             log_info( "error 3" );
             readok = 0;
@@ -336,11 +401,9 @@ NODE* load_node( char* bin_file )
         }
         else
         {
-            if ( fileread(
-                pf                  ,
-                fname               ,
-                MAX_WORD_NAME_LEN
-            ) != MAX_WORD_NAME_LEN )
+            fname = load_name( names , namecount , pf );
+            
+            if ( fname == NULL )
             {
                 log_info( "error 1" );
                 readok = 0;
@@ -353,7 +416,7 @@ NODE* load_node( char* bin_file )
             {
                 if ( temp->type == NT_SCNODE )
                 {
-                    if ( strcmp( temp->name , fname ) == 0 )
+                    if ( temp->name == fname )
                     {
                         break;
                     }
@@ -373,6 +436,7 @@ NODE* load_node( char* bin_file )
         }
     }
     
+    memfree( names );
     fileclose( pf );
     
     if ( readok )
@@ -13,6 +13,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  * */
 
+#define MEMALLOC_CATEGORY   MEMCAT_DUMP
+
 #include "logger.h"
 #include "mem.h"
 #include "datadump.h"
@@ -96,14 +98,66 @@ static int tbl_read_data_callback(
     RUNTIME*    runtime
 );
 
+/* keys are read back with the file position of their value as data */
+static int read_table_keys( RUNTIME* runtime , HFMAP table , int count )
+{
+    int         i;
+    int         len;
+    int         size = MAX_KEY_LEN;
+    char*       key;
+    UINT64      itempos;
+    
+    key = memalloc( size );
+    
+    for ( i = 0; i < count; i++ )
+    {
+        if ( ( fileread( runtime->fData , &len , INT_SIZE ) != INT_SIZE )
+            || ( len < 0 ) )
+        {
+            break;
+        }
+        
+        if ( len >= size )
+        {
+            /* a damaged file must not ask for more than it still holds */
+            if ( len > filesize( runtime->fData ) - filetell( runtime->fData ) )
+            {
+                break;
+            }
+            
+            memfree( key );
+            size = len + 1;
+            key = memalloc( size );
+        }
+        
+        key[len] = 0;
+        
+        if ( fileread( runtime->fData , key , len ) != len )
+        {
+            break;
+        }
+        
+        if ( fileread(
+            runtime->fData  ,
+            &itempos        ,
+            INT64_SIZE
+        ) != INT64_SIZE )
+        {
+            break;
+        }
+        
+        fmap_insert64_len( table , key , len , itempos );
+    }
+    
+    memfree( key );
+    return ( i == count );
+}
+
 RT_VALUE* read_data( RUNTIME* runtime , UINT64 pos )
 {
     RT_VALUE*   value;
     int         i;
     int         count;
-    int         len;
-    char        key[MAX_KEY_LEN];
-    UINT64      itempos;
     UINT64      keydumpsize;
     
     value = map_int_query( runtime->loadvar , pos );
@@ -121,7 +175,7 @@ RT_VALUE* read_data( RUNTIME* runtime , UINT64 pos )
     
     if ( value == NULL )
     {
-        value = memalloc_zero( sizeof( RT_VALUE ) );
+        value = alloc_value( runtime );
     }
     
     value->fpos = pos;
@@ -130,14 +184,14 @@ RT_VALUE* read_data( RUNTIME* runtime , UINT64 pos )
     if ( count != INT_SIZE )
     {
         count = filetell( runtime->fData );
-        memfree( value );
+        dealloc_value( runtime , value );
         log_error( "fileread Error" );
         return NULL;
     }
     
     if ( fileread( runtime->fData , &value->ref , INT_SIZE ) != INT_SIZE )
     {
-        memfree( value );
+        dealloc_value( runtime , value );
         log_error( "fileread Error" );
         return NULL;
     }
@@ -146,7 +200,7 @@ RT_VALUE* read_data( RUNTIME* runtime , UINT64 pos )
     {
         if ( fileread( runtime->fData , &value->size , INT_SIZE ) != INT_SIZE )
         {
-            memfree( value );
+            dealloc_value( runtime , value );
             log_error( "fileread Error" );
             return NULL;
         }
@@ -159,7 +213,7 @@ RT_VALUE* read_data( RUNTIME* runtime , UINT64 pos )
             value->size
         ) != value->size )
         {
-            memfree( value );
+            dealloc_value( runtime , value );
             log_error( "fileread Error" );
             return NULL;
         }
@@ -168,7 +222,7 @@ RT_VALUE* read_data( RUNTIME* runtime , UINT64 pos )
     {
         if ( fileread( runtime->fData , &count , INT_SIZE ) != INT_SIZE )
         {
-            memfree( value );
+            dealloc_value( runtime , value );
             log_error( "fileread Error" );
             return NULL;
         }
@@ -181,76 +235,41 @@ RT_VALUE* read_data( RUNTIME* runtime , UINT64 pos )
                 INT64_SIZE
             ) != INT64_SIZE )
             {
-                memfree( value );
+                dealloc_value( runtime , value );
                 log_error( "fileread Error" );
                 return NULL;
             }
             
-            value->data = dmap_init( count );
+            value->data = fmap_init( count );
             
-            for ( i = 0; i < count; i++ )
+            if ( read_table_keys( runtime , value->data , count ) == 0 )
             {
-                if ( fileread( runtime->fData , &len , INT_SIZE ) != INT_SIZE )
-                {
-                    dmap_release( value->data , NULL , NULL );
-                    memfree( value );
-                    log_error( "fileread Error" );
-                    return NULL;
-                }
-                
-                if ( len >= MAX_KEY_LEN )
-                {
-                    dmap_release( value->data , NULL , NULL );
-                    memfree( value );
-                    log_error( "fileread Error" );
-                    return NULL;
-                }
-                
-                key[len] = 0;
-                
-                if ( fileread( runtime->fData , key , len ) != len )
-                {
-                    dmap_release( value->data , NULL , NULL );
-                    memfree( value );
-                    log_error( "fileread Error" );
-                    return NULL;
-                }
-                
-                if ( fileread(
-                    runtime->fData  ,
-                    &itempos        ,
-                    INT64_SIZE
-                ) != INT64_SIZE )
-                {
-                    dmap_release( value->data , NULL , NULL );
-                    memfree( value );
-                    log_error( "fileread Error" );
-                    return NULL;
-                }
-                
-                dmap_insert64( value->data , key , itempos );
+                fmap_release( value->data , NULL , NULL );
+                dealloc_value( runtime , value );
+                log_error( "fileread Error" );
+                return NULL;
             }
             
-            if ( dmap_foreach2(
+            if ( fmap_foreach2(
                 value->data ,
-                ( DMAP_CALLBACK2 )tbl_read_data_callback ,
+                ( FMAP_CALLBACK2 )tbl_read_data_callback ,
                 runtime
             ) == 0 )
             {
-                dmap_release( value->data , NULL , NULL );
-                memfree( value );
+                fmap_release( value->data , NULL , NULL );
+                dealloc_value( runtime , value );
                 log_error( "table read Error" );
                 return NULL;
             }
         }
         else
         {
-            value->data = dmap_init( 3 );
+            value->data = fmap_init( 0 );
         }
     }
     else
     {
-        memfree( value );
+        dealloc_value( runtime , value );
         return NULL;
     }
     
@@ -285,7 +304,7 @@ static int tbl_read_data_callback(
         log_error( "read_data(%s) ERROR" , key );
     }*/
     /*=*/
-    value = memalloc_zero( sizeof( RT_VALUE ) );
+    value = alloc_value( runtime );
     value->fpos = *data_ptr;
     value->type = RVT_TBL_ITEM_UNLOAD;
     map_int_insert( runtime->loadvar , value->fpos , value );
@@ -297,13 +316,20 @@ static int tbl_read_data_callback(
 
 int tbl_write_data_callback( char* szKey , void* pData , RUNTIME* runtime );
 
-int tbl_write_key_callback( char* szKey , void* pData , RUNTIME* runtime );
+int tbl_write_key_callback(
+    char*           szKey   ,
+    unsigned int    len     ,
+    void*           pData   ,
+    RUNTIME*        runtime
+);
 
 UINT64 write_data( RUNTIME* runtime , RT_VALUE* value )
 {
     UINT64  pos;
     UINT64  keydumpsize;
     int     count;
+    int     type;
+    int     ref;
     
     if ( value->type == RVT_NULL )
     {
@@ -316,7 +342,8 @@ UINT64 write_data( RUNTIME* runtime , RT_VALUE* value )
         return value->fpos;
     }
     
-    if ( value->type == RVT_STRING )
+    /* numbers are stored as their text */
+    if ( value_cstr( value ) != NULL )
     {
         if ( value->fpos != 0 )
         {
@@ -325,14 +352,22 @@ UINT64 write_data( RUNTIME* runtime , RT_VALUE* value )
         
         fileseek( runtime->fData , 0 , FILESEEK_END );
         pos = filetell( runtime->fData );
+        type = RVT_STRING;
+        ref = value->ref;
         
-        if ( filewrite( runtime->fData , &value->type , INT_SIZE ) != INT_SIZE )
+        /* the runtime's own hold on shared values is not stored */
+        if ( value->gc & GC_PINNED )
+        {
+            ref--;
+        }
+        
+        if ( filewrite( runtime->fData , &type , INT_SIZE ) != INT_SIZE )
         {
             log_error( "write_data filewrite error" );
             return 0;
         }
         
-        if ( filewrite( runtime->fData , &value->ref , INT_SIZE ) != INT_SIZE )
+        if ( filewrite( runtime->fData , &ref , INT_SIZE ) != INT_SIZE )
         {
             log_error( "write_data filewrite error" );
             return 0;
@@ -359,9 +394,9 @@ UINT64 write_data( RUNTIME* runtime , RT_VALUE* value )
     }
     else if ( value->type == RVT_TABLE )
     {
-        if ( dmap_foreach(
+        if ( fmap_foreach(
             value->data ,
-            ( DMAP_CALLBACK )tbl_write_data_callback ,
+            ( FMAP_CALLBACK )tbl_write_data_callback ,
             runtime
         ) == 0 )
         {
@@ -389,7 +424,7 @@ UINT64 write_data( RUNTIME* runtime , RT_VALUE* value )
             return 0;
         }
         
-        count = dmap_getcount( value->data );
+        count = fmap_getcount( value->data );
         
         if ( filewrite( runtime->fData , &count , INT_SIZE ) != INT_SIZE )
         {
@@ -409,9 +444,9 @@ UINT64 write_data( RUNTIME* runtime , RT_VALUE* value )
             return 0;
         }
         
-        if ( dmap_foreach(
+        if ( fmap_foreach_len(
             value->data ,
-            ( DMAP_CALLBACK )tbl_write_key_callback ,
+            ( FMAP_CALLBACK_LEN )tbl_write_key_callback ,
             runtime
         ) == 0 )
         {
@@ -455,7 +490,7 @@ int tbl_write_data_callback( char* szKey , void* pData , RUNTIME* runtime )
     
     if ( ( value == NULL )
         || ( value->type == RVT_NULL )
-        || ( value->data == NULL ) )
+        || ( ( value->data == NULL ) && ( value_cstr( value ) == NULL ) ) )
     {
         return 1;
     }
@@ -469,8 +504,12 @@ int tbl_write_data_callback( char* szKey , void* pData , RUNTIME* runtime )
     return 1;
 }
 
-int tbl_write_key_callback( char* szKey , void* pData , RUNTIME* runtime )
-{
+int tbl_write_key_callback(
+    char*           szKey   ,
+    unsigned int    len     ,
+    void*           pData   ,
+    RUNTIME*        runtime
+) {
     int         count;
     RT_VALUE*   value;
     
@@ -478,12 +517,12 @@ int tbl_write_key_callback( char* szKey , void* pData , RUNTIME* runtime )
     
     if ( ( value == NULL )
         || ( value->type == RVT_NULL )
-        || ( value->data == NULL ) )
+        || ( ( value->data == NULL ) && ( value_cstr( value ) == NULL ) ) )
     {
         return 1;
     }
     
-    count = strlen( szKey );
+    count = len;
     
     if ( filewrite( runtime->fData , &count , INT_SIZE ) != INT_SIZE )
     {
@@ -578,11 +617,11 @@ void dmp_release( RUNTIME* runtime )
     free_dmp( runtime );
 }
 
-RT_VALUE* queryitem( RUNTIME* runtime , HDMAP hMap , char* key )
+RT_VALUE* queryitem( RUNTIME* runtime , HFMAP hMap , char* key )
 {
     RT_VALUE*   ret;
     
-    ret = dmap_query( hMap , key );
+    ret = fmap_query( hMap , key );
     
     if ( ret != NULL )
     {
@@ -666,7 +705,7 @@ int dmp_set_rtvalue(
     if ( rvmod == NULL )
     {
         rvmod = new_table_value( runtime );
-        dmap_insert( runtime->root->data , modname , rvmod );
+        fmap_insert( runtime->root->data , modname , rvmod );
         rvfunc = NULL;
     }
     else
@@ -677,7 +716,7 @@ int dmp_set_rtvalue(
     if ( rvfunc == NULL )
     {
         rvfunc = new_table_value( runtime );
-        dmap_insert( rvmod->data , nodename , rvfunc );
+        fmap_insert( rvmod->data , nodename , rvfunc );
     }
     else
     {
@@ -696,11 +735,11 @@ int dmp_set_rtvalue(
     
     if ( var != NULL )
     {
-        dmap_insert( rvfunc->data , varname , var );
+        fmap_insert( rvfunc->data , varname , var );
     }
     else
     {
-        dmap_erase( rvfunc->data , varname );
+        fmap_erase( rvfunc->data , varname );
     }
     
     return 1;
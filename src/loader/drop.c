@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#define MEMALLOC_CATEGORY   MEMCAT_TABLE
+
+#include "logger.h"
+#include "memalloc.h"
+#include "mem.h"
+#include "drop.h"
+
+#include <string.h>
+
+/*
+a table released while another one is being released, or a large one, is
+not walked on the spot: its map goes on a queue and the items are released
+a bounded number at a time, so a deep nest never recurses on the C stack
+and a huge table does not stall the node that happened to drop it
+*/
+
+DROP_QUEUE* new_drop_queue()
+{
+    return memalloc_zero( sizeof( DROP_QUEUE ) );
+}
+
+void free_drop_queue( DROP_QUEUE* queue )
+{
+    if ( queue == NULL )
+    {
+        return;
+    }
+    
+    memfree( queue->item );
+    memfree( queue );
+}
+
+static int drop_item_callback( char* key , void* data , RUNTIME* runtime )
+{
+    if ( data != NULL )
+    {
+        unref_value( runtime , data );
+    }
+    
+    return 1;
+}
+
+static void drop_push( DROP_QUEUE* queue , HFMAP map )
+{
+    DROP_ITEM*  grown;
+    
+    if ( queue->count >= queue->size )
+    {
+        queue->size = ( queue->size > 0 ) ? queue->size * 2 : 16;
+        grown = memalloc( sizeof( DROP_ITEM ) * queue->size );
+        
+        if ( queue->count > 0 )
+        {
+            memcpy( grown , queue->item , sizeof( DROP_ITEM ) * queue->count );
+        }
+        
+        memfree( queue->item );
+        queue->item = grown;
+    }
+    
+    queue->item[ queue->count ].map = map;
+    fmap_iter_init( map , &( queue->item[ queue->count ].iter ) );
+    queue->count++;
+    queue->deferred++;
+}
+
+/* release queued items above base, returns the items released */
+static SLINT drop_run( RUNTIME* runtime , SLINT base , SLINT budget )
+{
+    DROP_QUEUE* queue = runtime->drop;
+    DROP_ITEM*  top;
+    HFMAP       map;
+    char*       key;
+    RT_VALUE*   item;
+    SLINT       done = 0;
+    
+    queue->depth++;
+    
+    while ( ( queue->count > base ) && ( ( budget <= 0 ) || ( done < budget ) ) )
+    {
+        /* releasing an item may push, so the top is looked up again */
+        top = &( queue->item[ queue->count - 1 ] );
+        
+        if ( fmap_iter_next( top->map , &( top->iter ) , &key , ( void** )&item ) )
+        {
+            done++;
+            
+            if ( item != NULL )
+            {
+                unref_value( runtime , item );
+            }
+        }
+        else
+        {
+            map = top->map;
+            queue->count--;
+            fmap_release( map , NULL , NULL );
+        }
+    }
+    
+    queue->depth--;
+    queue->items += done;
+    return done;
+}
+
+void drop_table( RUNTIME* runtime , HFMAP map )
+{
+    DROP_QUEUE* queue = runtime->drop;
+    SLINT       base;
+    
+    if ( queue == NULL )
+    {
+        fmap_release( map , ( FMAP_CALLBACK )drop_item_callback , runtime );
+        return;
+    }
+    
+    if ( ( queue->depth > 0 ) || ( fmap_getcount( map ) >= DROP_LARGE ) )
+    {
+        drop_push( queue , map );
+        return;
+    }
+    
+    /* a small table goes now, what it held is freed up to the budget */
+    base = queue->count;
+    queue->depth++;
+    fmap_release( map , ( FMAP_CALLBACK )drop_item_callback , runtime );
+    queue->depth--;
+    drop_run( runtime , base , DROP_INLINE_BUDGET );
+}
+
+void drop_step( RUNTIME* runtime )
+{
+    if ( ( runtime->drop != NULL ) && ( runtime->drop->count > 0 ) )
+    {
+        drop_run( runtime , 0 , DROP_STEP_BUDGET );
+    }
+}
+
+void drop_flush( RUNTIME* runtime )
+{
+    if ( ( runtime->drop != NULL ) && ( runtime->drop->count > 0 ) )
+    {
+        drop_run( runtime , 0 , 0 );
+    }
+}
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+#ifndef __LOADER_DROP_H_INCLUDED__
+#define __LOADER_DROP_H_INCLUDED__
+
+#include "slang.h"
+
+/* a table with this many items is never freed on the spot */
+#define DROP_LARGE              1024
+
+/* items a release may free before it leaves the rest for later */
+#define DROP_INLINE_BUDGET      256
+
+/* items one call boundary frees from the queue */
+#define DROP_STEP_BUDGET        4096
+
+typedef struct _DROP_ITEM       DROP_ITEM;
+
+struct _DROP_ITEM
+{
+    HFMAP       map;        /* detached from its value, only this holds it */
+    FMAP_ITER   iter;       /* items before it are released already */
+};
+
+typedef struct _DROP_QUEUE      DROP_QUEUE;
+
+struct _DROP_QUEUE
+{
+    DROP_ITEM*  item;       /* worked from the top, newest first */
+    SLINT       count;
+    SLINT       size;
+    SLINT       depth;      /* > 0 while items are being released */
+    UINT64      deferred;   /* tables put on the queue */
+    UINT64      items;      /* items released from the queue */
+};
+
+DROP_QUEUE* new_drop_queue();
+
+void free_drop_queue( DROP_QUEUE* queue );
+
+#endif
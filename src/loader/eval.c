@@ -13,12 +13,15 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  * */
 
+#define MEMALLOC_CATEGORY   MEMCAT_EVAL
+
 #include "logger.h"
 #include "errorstr.h"
 #include "eval.h"
 #include "stack.h"
 #include "mem.h"
 #include "slanglex.h"
+#include "bigdec.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -29,21 +32,205 @@
 #define EVAL_EQU    ( 0x10000 | '=' )
 #define EVAL_NEQ    ( 0x10000 | '!' )
 
+#define EVAL_IS_CMP( code )                                             \
+    ( ( ( code ) == '>' ) || ( ( code ) == '<' )                        \
+        || ( ( code ) == EVAL_GE ) || ( ( code ) == EVAL_LE )           \
+        || ( ( code ) == EVAL_EQU ) || ( ( code ) == EVAL_NEQ ) )
+
+#define EVAL_INT64_MAX  ( ( INT64 )0x7FFFFFFFFFFFFFFFLL )
+#define EVAL_INT64_MIN  ( - EVAL_INT64_MAX - 1 )
+
+/* bytes one evaluation can take before falling back to the heap */
+#define EVAL_ARENA_SIZE     2048
+
+typedef struct _EVAL_BLOCK  EVAL_BLOCK;
+
+/* a request the arena could not hold, the data follows the header */
+struct _EVAL_BLOCK
+{
+    EVAL_BLOCK*     prev;
+    EVAL_BLOCK*     next;
+};
+
+/*
+intermediate text, limbs and deep stacks of one run_evaluate_scalar, all
+dropped at once when it returns, text in here is never owned by a scalar
+*/
+typedef struct _EVAL_ARENA
+{
+    SLINT           used;
+    EVAL_BLOCK*     block;
+    INT64           data[ EVAL_ARENA_SIZE / 8 ];
+}
+EVAL_ARENA;
+
+static void eval_arena_init( EVAL_ARENA* arena )
+{
+    arena->used = 0;
+    arena->block = NULL;
+}
+
+static void* eval_arena_alloc( EVAL_ARENA* arena , SLINT size )
+{
+    EVAL_BLOCK* block;
+    void*       ret;
+    
+    size = ( size + 7 ) & ~7;
+    
+    if ( arena->used + size <= EVAL_ARENA_SIZE )
+    {
+        ret = ( bchar* )arena->data + arena->used;
+        arena->used += size;
+        return ret;
+    }
+    
+    block = memalloc( sizeof( EVAL_BLOCK ) + size );
+    block->prev = NULL;
+    block->next = arena->block;
+    
+    if ( arena->block != NULL )
+    {
+        arena->block->prev = block;
+    }
+    
+    arena->block = block;
+    return block + 1;
+}
+
+static EVAL_BLOCK* eval_arena_block( EVAL_ARENA* arena , void* ptr )
+{
+    EVAL_BLOCK* block;
+    
+    for ( block = arena->block; block != NULL; block = block->next )
+    {
+        if ( ( void* )( block + 1 ) == ptr )
+        {
+            return block;
+        }
+    }
+    
+    return NULL;
+}
+
+static void eval_arena_unlink( EVAL_ARENA* arena , EVAL_BLOCK* block )
+{
+    if ( block->prev != NULL )
+    {
+        block->prev->next = block->next;
+    }
+    else
+    {
+        arena->block = block->next;
+    }
+    
+    if ( block->next != NULL )
+    {
+        block->next->prev = block->prev;
+    }
+}
+
+/* scratch that is done with, only a heap block is given back early */
+static void eval_arena_free( EVAL_ARENA* arena , void* ptr )
+{
+    EVAL_BLOCK* block;
+    
+    if ( ( ptr == NULL )
+        || ( ( ( bchar* )ptr >= ( bchar* )arena->data )
+            && ( ( bchar* )ptr < ( bchar* )arena->data + EVAL_ARENA_SIZE ) ) )
+    {
+        return;
+    }
+    
+    block = eval_arena_block( arena , ptr );
+    
+    if ( block != NULL )
+    {
+        eval_arena_unlink( arena , block );
+        memfree( block );
+    }
+}
+
+/* text that outlives the arena, a heap block is moved instead of copied */
+static void eval_arena_keep( EVAL_ARENA* arena , EVAL_SCALAR* scalar )
+{
+    EVAL_BLOCK* block;
+    bchar*      text = scalar->text;
+    
+    if ( ( text == NULL ) || scalar->owned )
+    {
+        return;
+    }
+    
+    if ( ( text >= ( bchar* )arena->data )
+        && ( text < ( bchar* )arena->data + EVAL_ARENA_SIZE ) )
+    {
+        scalar->text = dup_str( text );
+        scalar->owned = 1;
+        return;
+    }
+    
+    block = eval_arena_block( arena , text );
+    
+    if ( block != NULL )
+    {
+        eval_arena_unlink( arena , block );
+        memmove( block , text , strlen( text ) + 1 );
+        scalar->text = ( bchar* )block;
+        scalar->owned = 1;
+    }
+}
+
+static void eval_arena_reset( EVAL_ARENA* arena )
+{
+    EVAL_BLOCK* block;
+    
+    while ( arena->block != NULL )
+    {
+        block = arena->block;
+        arena->block = block->next;
+        memfree( block );
+    }
+    
+    arena->used = 0;
+}
+
 bchar* evaluate( NODE_PARAM* param , bchar* str )
 {
-    SLINT       pos = 0;
-    EVAL_VALUE* evalret;
+    EVAL_SCALAR result;
+    
+    if ( ! evaluate_scalar( param , str , &result ) )
+    {
+        return NULL;
+    }
+    
+    return eval_scalar_detach( &result );
+}
+
+SLINT evaluate_scalar( NODE_PARAM* param , bchar* str , EVAL_SCALAR* result )
+{
+    SLINT       ret;
+    EVAL_PROG*  prog;
     
-    evalret = build_evaluate( param , str , strlen( str ) , &pos );
+    prog = compile_evaluate( param , str );
     
-    if ( evalret == NULL )
+    if ( prog == NULL )
     {
         log_error( ERROR_EVAL );
-        return ( bchar* )dup_str( "0" );
+        memset( result , 0 , sizeof( EVAL_SCALAR ) );
+        result->type = EST_INT;
+        return 1;
+    }
+    
+    ret = run_evaluate_scalar( param , prog , result );
+    
+    /* the result may point into the program freed here */
+    if ( ret && ( result->text != NULL ) && ! result->owned )
+    {
+        result->text = dup_str( result->text );
+        result->owned = 1;
     }
     
-    bchar* ret = run_evaluate( param , evalret );
-    free_evaluate( evalret );
+    free_eval_prog( prog );
     
     return ret;
 }
@@ -70,7 +257,7 @@ SLINT e_shift_nameword( bchar* buffer , SLINT buffer_size , SLINT* cur_pos )
         backpos = *cur_pos;
         c = shift_word( buffer , buffer_size , cur_pos );
         
-        if ( ! is_name( c ) )
+        if ( ( c == 0 ) || ! is_name( c ) )
         {
             break;
         }
@@ -284,136 +471,6 @@ SLINT e_shift_clause(
     return end_pos;
 }
 
-bchar* get_param_value( NODE_PARAM* param , bchar* name )
-{
-    bchar*      ret;
-    SLINT       i;
-    PARAM_ITEM* pitem = param->list;
-    
-    if ( name == NULL )
-    {
-        return "";
-    }
-    
-    for ( i = 0; i < param->count; i++ )
-    {
-        pitem = &(param->list[i]);
-        
-        if ( strcmp( pitem->name , name ) == 0 )
-        {
-            if ( ( pitem->value != NULL )
-                && ( pitem->value->type == RVT_STRING ) )
-            {
-                if ( pitem->value->data != NULL )
-                {
-                    return pitem->value->data;
-                }
-            }
-        }
-    }
-    
-    return name;
-}
-
-bchar* copy_param_value( NODE_PARAM* param , bchar* name )
-{
-    bchar*      ret;
-    SLINT       i;
-    PARAM_ITEM* pitem = param->list;
-    
-    for ( i = 0; i < param->count; i++ )
-    {
-        pitem = &(param->list[i]);
-        
-        if ( strcmp( pitem->name , name ) == 0 )
-        {
-            if ( ( pitem->value != NULL )
-                && ( pitem->value->type == RVT_STRING ) )
-            {
-                if ( pitem->value->data != NULL )
-                {
-                    return dup_str( pitem->value->data );
-                }
-            }
-            
-            return dup_str( "" );
-        }
-    }
-    
-    return dup_str( name );
-}
-
-bchar* strformat( NODE_PARAM* param , bchar* value )
-{
-    bchar*  ret;
-    bchar*  tmp;
-    bchar*  substr;
-    SLINT   tsize = 0;
-    SLINT   nsize = 0;
-    SLINT   pos = 0;
-    SLINT   str_len = strlen( value );
-    CLAUSE  clause;
-    bchar   tempstr[16];
-    
-    memset( &clause , 0 , sizeof( CLAUSE ) );
-    memset( tempstr , 0 , 16 );
-    
-    tsize = 128;
-    ret = memalloc_zero( tsize );
-    
-    while ( pos < str_len )
-    {
-        e_shift_clause( value , str_len , &pos , &clause , 0 );
-        
-        if ( clause.type == CT_ENDFILE )
-        {
-            break;
-        }
-        else if ( clause.type == CT_ERRORWORD )
-        {
-            log_error( "error" );
-            free_clause( &clause );
-            strcpy( ret , "error" );
-            return ret;
-        }
-        
-        substr = NULL;
-        
-        if ( ( clause.type == CT_VARIABLE ) && clause.constvalue )
-        {
-            substr = get_param_value( param , clause.constvalue );
-        }
-        else if ( ( clause.type == CT_CONST ) && clause.constvalue )
-        {
-            substr = clause.constvalue;
-        }
-        else if ( clause.type == CT_KEY )
-        {
-            snprintf( tempstr , 16 , "%c" , clause.key );
-            substr = tempstr;
-        }
-        
-        if ( substr != NULL )
-        {
-            nsize = strlen( ret ) + strlen( substr );
-            
-            if ( nsize >= tsize )
-            {
-                tsize = nsize + 32;
-                tmp = memalloc_zero( tsize );
-                strcpy( tmp , ret );
-                memfree( ret );
-                ret = tmp;
-            }
-            
-            strcat( ret , substr );
-        }
-    }
-    
-    free_clause( &clause );
-    return ret;
-}
-
 void free_stack_code( EVAL_CODE* code )
 {
     EVAL_CODE* temp;
@@ -452,628 +509,875 @@ void free_stack_data( STACK* stackdata )
     }
 }
 
-/*
-string to bin, "-12.34" => ± 1,2,.,3,4
-*/
-bchar* strnumtobin(
-    bchar*  data            ,
-    SLINT   base            ,
-    SLINT   containdotsign  ,
-    SLINT*  prlen           ,
-    SLINT*  pdotlen         ,
-    SLINT*  psign
-) {
-    SLINT   len , dlen , i;
-    bchar*  pbuf;
+/* canonical decimal integers only, so the text reads back the same */
+SLINT eval_parse_int( bchar* str , INT64* result )
+{
+    INT64   value;
+    SLINT   sign;
+    SLINT   digits;
     
-    if ( data == NULL || prlen == NULL || psign == NULL )
+    if ( str == NULL )
     {
-        return NULL;
+        return 0;
     }
     
-    if ( base > 16 )
+    sign = ( *str == '-' );
+    
+    if ( sign )
     {
-        return NULL;
+        str++;
     }
     
-    /* remove spaces */
-    while ( *data )
+    if ( ( *str < '0' ) || ( *str > '9' ) )
     {
-        if ( ( ( *data ) != ' ')
-            && ( ( *data ) != '\t' )
-            && ( ( *data ) != '\n' )
-            && ( ( *data ) != '\r' ) )
-        {
-            break;
-        }
-        
-        data++;
+        return 0;
     }
     
-    /* remove prefix 0 */
-    while ( *data )
+    if ( ( *str == '0' ) && ( sign || ( str[1] != 0 ) ) )
     {
-        if ( ( *data ) != '0' )
-        {
-            break;
-        }
-        
-        data++;
+        return 0;
     }
     
-    len = 0;
-    while ( data[len] )
+    value = 0;
+    digits = 0;
+    
+    while ( ( *str >= '0' ) && ( *str <= '9' ) )
     {
-        if ( data[len] == '.' )
+        /* 18 digits always fit */
+        if ( ++digits > 18 )
         {
-            break;
+            return 0;
         }
         
-        len++;
+        value = value * 10 + ( *str - '0' );
+        str++;
     }
     
-    if ( len == 0 )
+    if ( *str != 0 )
     {
-        return NULL;
+        return 0;
     }
     
-    if ( data[len] == '.' )
-    {
-        dlen = strlen( data + len + 1 );
-    }
-    else
+    *result = sign ? -value : value;
+    return 1;
+}
+
+void eval_scalar_free( EVAL_SCALAR* scalar )
+{
+    if ( scalar->owned )
     {
-        dlen = 0;
+        memfree( scalar->text );
     }
     
-    if ( data[0] == '-' )
+    scalar->text = NULL;
+    scalar->owned = 0;
+}
+
+void eval_scalar_set_text( EVAL_SCALAR* scalar , bchar* text , SLINT owned )
+{
+    INT64   value;
+    
+    memset( scalar , 0 , sizeof( EVAL_SCALAR ) );
+    
+    if ( eval_parse_int( text , &value ) )
     {
-        len--;
+        scalar->type = EST_INT;
+        scalar->i = value;
         
-        if ( len == 0 )
+        if ( owned )
         {
-            return NULL;
+            memfree( text );
         }
-        
-        *psign = 1;
     }
     else
     {
-        *psign = 0;
+        scalar->type = EST_TEXT;
+        scalar->text = text;
+        scalar->owned = owned;
     }
+}
+
+bchar* eval_scalar_text( EVAL_SCALAR* scalar )
+{
+    bchar   buf[32];
     
-    if ( containdotsign )
-    {
-        pbuf = memalloc_zero( len + dlen + 3 );
-        
-        if ( *psign )
-        {
-            memcpy( pbuf , data , len + dlen + 2 );
-        }
-        else
-        {
-            memcpy( pbuf + 1 , data , len + dlen + 1 );
-            pbuf[0] = ' ';
-        }
-        
-        for ( i = 1; i <= len; i++ )
-        {
-            pbuf[i] -= '0';
-        }
-        
-        for ( i = len + 2; i <= len + dlen + 1; i++ )
-        {
-            pbuf[i] -= '0';
-        }
-    }
-    else
+    if ( scalar->text == NULL )
     {
-        pbuf = memalloc_zero( len + dlen + 1 );
+        buf[0] = 0;
         
-        if ( *psign )
+        if ( scalar->type == EST_INT )
         {
-            memcpy( pbuf , data + 1 , len );
-            memcpy( pbuf + len , data + len + 2 , dlen );
+            snprintf( buf , 32 , "%lld" , scalar->i );
         }
-        else
+        else if ( scalar->type == EST_DOUBLE )
         {
-            memcpy( pbuf , data , len );
-            memcpy( pbuf + len , data + len + 1 , dlen );
+            format_double( buf , 32 , scalar->d );
         }
         
-        for ( i = 0; i < len + dlen; i++ )
-        {
-            pbuf[i] -= '0';
-        }
+        scalar->text = dup_str( buf );
+        scalar->owned = 1;
     }
     
-    *prlen = len;
-    *pdotlen = dlen;
-    return pbuf;
+    return scalar->text;
 }
 
-void trimzero( bchar* ret )
+/* text of the scalar without allocating, numbers are formatted into buf */
+bchar* eval_scalar_cstr( EVAL_SCALAR* scalar , bchar* buf , SLINT size )
 {
-    SLINT   i;
-    SLINT   len;
-    
-    len = strlen( ret );
-    
-    i = 1;
-    
-    while ( ( ret[i] == ' ' ) || ( ret[i] == '0' ) )
+    if ( scalar->text != NULL )
     {
-        i++;
+        return scalar->text;
     }
     
-    if ( ret[0] == ' ' )
+    buf[0] = 0;
+    
+    if ( scalar->type == EST_INT )
     {
-        memmove( ret , ret + i , len - i + 1 );
+        snprintf( buf , size , "%lld" , scalar->i );
     }
-    else
+    else if ( scalar->type == EST_DOUBLE )
     {
-        if ( i > 1 )
-        {
-            memmove( ret + 1 , ret + i , len - i + 1 );
-        }
+        format_double( buf , size , scalar->d );
     }
     
-    i = len - 1;
+    return buf;
+}
+
+/* like eval_scalar_text, but a number is formatted into the arena */
+static bchar* eval_scalar_arena_text( EVAL_SCALAR* scalar , EVAL_ARENA* arena )
+{
+    bchar   buf[32];
+    SLINT   len;
     
-    while ( ( ret[i] == ' ' ) || ( ret[i] == '0' ) )
+    if ( scalar->text == NULL )
     {
-        ret[i] = 0;
-        i--;
+        eval_scalar_cstr( scalar , buf , 32 );
+        len = strlen( buf );
+        scalar->text = eval_arena_alloc( arena , len + 1 );
+        memcpy( scalar->text , buf , len + 1 );
+        scalar->owned = 0;
     }
+    
+    return scalar->text;
 }
 
-bchar* evaluate_add( bchar* data1 , bchar* data2 )
+/* text of the scalar as a string the caller frees */
+bchar* eval_scalar_detach( EVAL_SCALAR* scalar )
 {
     bchar*  ret;
-    SLINT   dlen1 , dlen2 , dotlen1 , dotlen2 , rlen , rdotlen , i;
-    bchar*  bin1;
-    bchar*  bin2;
-    SLINT   base;
-    SLINT   sign1 , sign2 , rsign;
-    bchar*  tmpret;
-    bchar*  tmpbin1;
-    bchar*  tmpbin2;
-    
-    sign1 = 0;
-    sign2 = 0;
-    rsign = 0;
-    base = 10;
     
-    bin1 = strnumtobin( data1 , base , 1 , &dlen1 , &dotlen1 , &sign1 );
-    bin2 = strnumtobin( data2 , base , 1 , &dlen2 , &dotlen2 , &sign2 );
+    ret = eval_scalar_text( scalar );
     
-    if ( ( bin1 == NULL ) || ( dlen1 == 0 ) )
+    if ( ! scalar->owned )
     {
-        return dup_str( data2 );
+        ret = dup_str( ret );
     }
     
-    if ( ( bin2 == NULL ) || ( dlen2 == 0 ) )
-    {
-        return dup_str( data1 );
-    }
+    scalar->text = NULL;
+    scalar->owned = 0;
+    return ret;
+}
+
+/* a condition holds when its text starts with '1' */
+SLINT eval_scalar_truth( EVAL_SCALAR* scalar )
+{
+    INT64   value;
+    bchar   buf[32];
     
-    /* take the maximum length */
-    if ( dlen1 > dlen2 )
+    if ( scalar->type == EST_INT )
     {
-        rlen = dlen1;
-        rsign = sign1;
-        sign2 =sign1 ^ sign2;
-        sign1 = 0;
+        value = scalar->i;
+        
+        while ( value >= 10 )
+        {
+            value /= 10;
+        }
+        
+        return ( value == 1 );
     }
-    else if ( dlen1 < dlen2 )
+    
+    return ( eval_scalar_cstr( scalar , buf , 32 )[0] == '1' );
+}
+
+void eval_param_index(
+    NODE_PARAM*     param   ,
+    SLINT           index   ,
+    EVAL_SCALAR*    result
+) {
+    RT_VALUE*   value = NULL;
+    
+    if ( ( UINT )index < param->count )
     {
-        rlen = dlen2;
-        rsign = sign2;
-        sign1 =sign1 ^ sign2;
-        sign2 = 0;
+        value = PARAM_VALUE( param , index );
+    }
+    
+    if ( value == NULL )
+    {
+        eval_scalar_set_text( result , "" , 0 );
+    }
+    else if ( value->type == RVT_INT64 )
+    {
+        memset( result , 0 , sizeof( EVAL_SCALAR ) );
+        result->type = EST_INT;
+        result->i = value->num.i;
+    }
+    else if ( value->type == RVT_DOUBLE )
+    {
+        memset( result , 0 , sizeof( EVAL_SCALAR ) );
+        result->type = EST_DOUBLE;
+        result->d = value->num.d;
+    }
+    else if ( RVT_IS_SCALAR( value->type ) && ( value_cstr( value ) != NULL ) )
+    {
+        eval_scalar_set_text( result , value->data , 0 );
     }
     else
     {
-        rlen = dlen1;
+        eval_scalar_set_text( result , "" , 0 );
+    }
+}
+
+/* slot of a parameter name, -1 when the node has none by that name */
+SLINT eval_param_find( NODE_PARAM* param , bchar* name )
+{
+    SLINT   i;
+    
+    if ( param == NULL )
+    {
+        return -1;
+    }
+    
+    for ( i = 0; i < param->count; i++ )
+    {
+        if ( strcmp( param->list[i].name , name ) == 0 )
+        {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+static void eval_format_append(
+    EVAL_FORMAT*    format  ,
+    SLINT*          size    ,
+    SLINT           type    ,
+    SLINT           index   ,
+    bchar*          text
+) {
+    EVAL_SEGMENT*   seg;
+    SLINT           len = strlen( text );
+    bchar*          tmp;
+    
+    if ( len == 0 )
+    {
+        return;
+    }
+    
+    seg = ( format->count > 0 ) ? &format->seg[ format->count - 1 ] : NULL;
+    
+    /* neighbouring literals are copied as one run */
+    if ( ( type == ESG_TEXT ) && ( seg != NULL ) && ( seg->type == ESG_TEXT ) )
+    {
+        tmp = memalloc_zero( seg->len + len + 1 );
+        memcpy( tmp , seg->text , seg->len );
+        memcpy( tmp + seg->len , text , len );
+        memfree( seg->text );
+        seg->text = tmp;
+        seg->len += len;
+        return;
+    }
+    
+    if ( format->count >= *size )
+    {
+        *size = ( *size == 0 ) ? 8 : ( *size * 2 );
+        seg = memalloc_zero( sizeof( EVAL_SEGMENT ) * ( *size ) );
         
-        rsign = 1;
+        if ( format->count > 0 )
+        {
+            memcpy( seg , format->seg , sizeof( EVAL_SEGMENT ) * format->count );
+        }
+        
+        memfree( format->seg );
+        format->seg = seg;
+    }
+    
+    seg = &format->seg[ format->count++ ];
+    seg->type = type;
+    seg->index = index;
+    seg->text = dup_str( text );
+    seg->len = len;
+}
+
+EVAL_FORMAT* compile_strformat( NODE_PARAM* param , bchar* value )
+{
+    EVAL_FORMAT*    ret;
+    SLINT           size = 0;
+    SLINT           pos = 0;
+    SLINT           index;
+    SLINT           str_len = strlen( value );
+    CLAUSE          clause;
+    bchar           tempstr[2];
+    
+    memset( &clause , 0 , sizeof( CLAUSE ) );
+    ret = memalloc_zero( sizeof( EVAL_FORMAT ) );
+    
+    while ( pos < str_len )
+    {
+        e_shift_clause( value , str_len , &pos , &clause , 0 );
         
-        for ( i = 1; i <= dlen1; i++ )
+        if ( clause.type == CT_ENDFILE )
         {
-            if ( bin1[i] < bin2[i] )
-            {
-                rsign = 0;
-                break;
-            }
+            break;
+        }
+        else if ( clause.type == CT_ERRORWORD )
+        {
+            free_clause( &clause );
+            free_strformat( ret );
+            return NULL;
         }
         
-        if ( rsign == 1 )
+        if ( ( clause.type == CT_VARIABLE ) && clause.constvalue )
         {
-            for ( i = 0; i <= MIN( dotlen1 , dotlen2 ); i++ )
-            {
-                if ( bin1[dlen1 + 2 + i] < bin2[dlen1 + 2 + i] )
-                {
-                    rsign = 0;
-                    break;
-                }
-            }
+            index = eval_param_find( param , clause.constvalue );
             
-            if ( rsign == 1 )
-            {
-                if ( dotlen2 > dotlen1 )
-                {
-                    rsign = 0;
-                }
-            }
+            /* an unknown name reads as itself */
+            eval_format_append(
+                ret ,
+                &size ,
+                ( index < 0 ) ? ESG_TEXT : ESG_PARAM ,
+                index ,
+                clause.constvalue
+            );
         }
-        
-        if ( rsign )
+        else if ( ( clause.type == CT_CONST ) && clause.constvalue )
         {
-            rsign = sign1;
-            sign2 =sign1 ^ sign2;
-            sign1 = 0;
+            eval_format_append( ret , &size , ESG_TEXT , 0 , clause.constvalue );
         }
-        else
+        else if ( clause.type == CT_KEY )
         {
-            rsign = sign2;
-            sign1 =sign1 ^ sign2;
-            sign2 = 0;
+            tempstr[0] = ( bchar )clause.key;
+            tempstr[1] = 0;
+            eval_format_append( ret , &size , ESG_TEXT , 0 , tempstr );
         }
     }
     
-    rdotlen = MAX( dotlen1 , dotlen2 );
-    
-    /* sign, carry, end char, decimal point*/
-    ret = memalloc_zero( rlen + rdotlen + 4 );
+    free_clause( &clause );
+    return ret;
+}
+
+/* the value's bytes, which may hold a zero, or the name when it has none */
+static bchar* eval_format_slot(
+    NODE_PARAM*     param   ,
+    EVAL_SEGMENT*   seg     ,
+    SLINT*          size
+) {
+    RT_VALUE*   value;
     
-    if ( rdotlen > 0 )
+    if ( ( UINT )seg->index < param->count )
     {
-        *(ret + rlen + 2) = '.';
+        value = PARAM_VALUE( param , seg->index );
         
-        for ( i = rdotlen; i > 0; i-- )
+        if ( value_cstr( value ) != NULL )
         {
-            tmpret = ret + rlen + 2 + i;
-            
-            if ( dotlen1 >= i )
-            {
-                tmpbin1 = bin1 + dlen1 + 1 + i;
-                
-                if ( sign1 )
-                {
-                    *tmpret -= *tmpbin1;
-                }
-                else
-                {
-                    *tmpret += *tmpbin1;
-                }
-                
-                dotlen1--;
-            }
-            
-            if ( dotlen2 >= i )
-            {
-                tmpbin2 = bin2 + dlen2 + 1 + i;
-                
-                if ( sign2 )
-                {
-                    *tmpret -= *tmpbin2;
-                }
-                else
-                {
-                    *tmpret += *tmpbin2;
-                }
-                
-                dotlen2--;
-            }
-            
-            if ( *tmpret >= base )
-            {
-                *tmpret -= base;
-                
-                if ( i == 1 )
-                {
-                    *(tmpret - 2) += 1;
-                }
-                else
-                {
-                    *(tmpret - 1) += 1;
-                }
-            }
-            else if ( *tmpret < 0 )
-            {
-                if ( i == 1 )
-                {
-                    *(tmpret - 2) -= 1;
-                }
-                else
-                {
-                    *(tmpret - 1) -= 1;
-                }
-                
-                *tmpret += base;
-            }
-            
-            *tmpret += '0';
+            *size = value->size;
+            return value->data;
         }
     }
     
-    for (i = rlen; i > 0; i-- )
+    *size = seg->len;
+    return seg->text;
+}
+
+/* sized first, then filled in one pass */
+bchar* run_strformat( NODE_PARAM* param , EVAL_FORMAT* format , SLINT* len )
+{
+    bchar*          ret;
+    bchar*          str;
+    EVAL_SEGMENT*   seg;
+    SLINT           total = 0;
+    SLINT           pos = 0;
+    SLINT           i;
+    SLINT           n;
+    
+    for ( i = 0; i < format->count; i++ )
     {
-        tmpret = ret + 1 + i;
-        tmpbin1 = bin1 + dlen1;
-        tmpbin2 = bin2 + dlen2;
+        seg = &format->seg[i];
         
-        if ( dlen1 > 0 )
+        if ( seg->type == ESG_TEXT )
         {
-            if ( sign1 )
-            {
-                *tmpret -= *tmpbin1;
-            }
-            else
-            {
-                *tmpret += *tmpbin1;
-            }
-            
-            dlen1--;
+            total += seg->len;
         }
-        
-        if ( dlen2 > 0 )
+        else
         {
-            if ( sign2 )
-            {
-                *tmpret -= *tmpbin2;
-            }
-            else
-            {
-                *tmpret += *tmpbin2;
-            }
-            
-            dlen2--;
+            eval_format_slot( param , seg , &n );
+            total += n;
         }
+    }
+    
+    ret = memalloc( total + 1 );
+    
+    for ( i = 0; i < format->count; i++ )
+    {
+        seg = &format->seg[i];
         
-        if ( *tmpret >= base )
+        if ( seg->type == ESG_TEXT )
         {
-            (*tmpret) -= base;
-            *(tmpret - 1) += 1;
+            memcpy( ret + pos , seg->text , seg->len );
+            pos += seg->len;
         }
-        else if ( *tmpret < 0 )
+        else
         {
-            *(tmpret - 1) -= 1;
-            (*tmpret) += base;
+            str = eval_format_slot( param , seg , &n );
+            memcpy( ret + pos , str , n );
+            pos += n;
         }
-        
-        *tmpret += '0';
     }
     
-    memfree( bin1 );
-    memfree( bin2 );
-    
-    ret[1] += '0';
+    ret[pos] = 0;
     
-    if ( rsign )
+    if ( len != NULL )
     {
-        ret[0] = '-';
-    }
-    else
-    {
-        ret[0] = ' ';
+        *len = pos;
     }
     
-    trimzero( ret );
-    
     return ret;
 }
 
-bchar* evaluate_sub( bchar* data1 , bchar* data2 )
+void free_strformat( EVAL_FORMAT* format )
 {
-    int     len;
-    bchar*  temp;
-    bchar*  ret;
+    SLINT   i;
     
-    if ( data2[0] == '-' )
+    if ( format == NULL )
     {
-        len = strlen( data2 );
-        temp = memalloc_zero( len + 1 );
-        strcpy( temp , data2 );
-        temp[0] = ' ';
+        return;
     }
-    else
+    
+    for ( i = 0; i < format->count; i++ )
     {
-        len = strlen( data2 );
-        temp = memalloc_zero( len + 2 );
-        strcpy( temp + 1 , data2 );
-        temp[0] = '-';
+        memfree( format->seg[i].text );
     }
     
-    ret = evaluate_add( data1 , temp );
-    
-    memfree( temp );
-    return ret;
+    memfree( format->seg );
+    memfree( format );
 }
 
-bchar* evaluate_mul( bchar* data1 , bchar* data2 )
+bchar* strformat( NODE_PARAM* param , bchar* value )
 {
-    bchar*  ret;
-    SLINT   dlen1 , dlen2 , dotlen1 , dotlen2 , i , j;
-    bchar*  bin1;
-    bchar*  bin2;
-    SLINT   base;
-    SLINT   sign1 , sign2;
-    bchar*  tmpret;
-    bchar*  tmprettail;
-    bchar*  tmpbin1;
-    bchar   tmpchar2;
-    
-    base = 10;
+    bchar*          ret;
+    EVAL_FORMAT*    format;
     
-    bin1 = strnumtobin( data1 , base , 0 , &dlen1 , &dotlen1 , &sign1 );
-    bin2 = strnumtobin( data2 , base , 0 , &dlen2 , &dotlen2 , &sign2 );
+    format = compile_strformat( param , value );
     
-    dlen1 += dotlen1;
-    dlen2 += dotlen2;
-    
-    if ( bin1 == NULL || dlen1 == 0 || bin2 == NULL || dlen2 == 0 )
+    if ( format == NULL )
     {
-        memfree( bin1 );
-        memfree( bin2 );
-        return dup_str( "0" );
+        log_error( "error" );
+        return dup_str( "error" );
     }
     
-    /* sign, end char,  decimal point */
-    ret = memalloc_zero( dlen1 + dlen2 + 3 );
-    
-    tmprettail = ret + dlen1 + dlen2 + 1;
+    ret = run_strformat( param , format , NULL );
+    free_strformat( format );
+    return ret;
+}
+
+/* return 0 on overflow, the caller falls back to the decimal strings */
+SLINT eval_int_op( SLINT code , INT64 a , INT64 b , EVAL_SCALAR* result )
+{
+    INT64   r;
     
-    for ( i = 1; i <= dlen2; i++ )
+    switch ( code )
     {
-        tmpret = tmprettail - i;
-        tmpbin1 = bin1 + dlen1;
-        tmpchar2 = *(bin2 + dlen2 - i);
+    case '+':
+        if ( ( b > 0 ) ? ( a > EVAL_INT64_MAX - b ) : ( a < EVAL_INT64_MIN - b ) )
+        {
+            return 0;
+        }
         
-        for ( j = 1; j <= dlen1; j++ )
+        r = a + b;
+        break;
+    case '-':
+        if ( ( b < 0 ) ? ( a > EVAL_INT64_MAX + b ) : ( a < EVAL_INT64_MIN + b ) )
         {
-            *tmpret += ( ( *( tmpbin1 - j ) ) * tmpchar2 );
-            
-            if ( *tmpret >= base )
+            return 0;
+        }
+        
+        r = a - b;
+        break;
+    case '*':
+        if ( ( a != 0 ) && ( b != 0 ) )
+        {
+            if ( ( a > 0 )
+                ? ( ( b > 0 ) ? ( a > EVAL_INT64_MAX / b )
+                    : ( b < EVAL_INT64_MIN / a ) )
+                : ( ( b > 0 ) ? ( a < EVAL_INT64_MIN / b )
+                    : ( b < EVAL_INT64_MAX / a ) ) )
             {
-                *(tmpret - 1) += (*tmpret) / base;
-                *tmpret = (*tmpret) % base;
+                return 0;
             }
-            
-            tmpret--;
         }
+        
+        r = a * b;
+        break;
+    case '/':
+        if ( b == 0 )
+        {
+            log_error( "div 0 error" );
+            r = 0;
+        }
+        else if ( ( a == EVAL_INT64_MIN ) && ( b == -1 ) )
+        {
+            return 0;
+        }
+        else
+        {
+            r = a / b;
+        }
+        break;
+    case '>':
+        r = ( a > b );
+        break;
+    case '<':
+        r = ( a < b );
+        break;
+    case EVAL_GE:
+        r = ( a >= b );
+        break;
+    case EVAL_LE:
+        r = ( a <= b );
+        break;
+    case EVAL_EQU:
+        r = ( a == b );
+        break;
+    case EVAL_NEQ:
+        r = ( a != b );
+        break;
+    default:
+        return 0;
     }
     
-    memfree( bin1 );
-    memfree( bin2 );
+    result->type = EST_INT;
+    result->i = r;
+    return 1;
+}
+
+SLINT eval_to_double( EVAL_SCALAR* scalar , double* result )
+{
+    bchar*  end;
     
-    for ( i = 1; i <= ( dlen1 + dlen2 ); i++ )
+    if ( scalar->type == EST_INT )
     {
-        ret[i] += '0';
+        *result = ( double )scalar->i;
+        return 1;
     }
     
-    dotlen1 += dotlen2;
-    
-    if ( dotlen1 > 0 )
+    if ( scalar->type == EST_DOUBLE )
     {
-        memmove(
-            tmprettail - dotlen1 + 1 ,
-            tmprettail - dotlen1 ,
-            dotlen1
-        );
-        *(tmprettail - dotlen1) = '.';
+        *result = scalar->d;
+        return 1;
     }
     
-    if ( sign1 ^ sign2 )
+    if ( ( scalar->text == NULL ) || ( scalar->text[0] == 0 ) )
     {
-        ret[0] = '-';
-    }
-    else
-    {
-        ret[0] = ' ';
+        return 0;
     }
     
-    trimzero( ret );
-    
-    return ret;
+    *result = strtod( scalar->text , &end );
+    return ( *end == 0 );
 }
 
-bchar* evaluate_div( bchar* data1 , bchar* data2 )
+SLINT eval_double_op( SLINT code , double a , double b , EVAL_SCALAR* result )
 {
-    /*TODO: */
-    
-    bchar*  ret;
-    SLINT   r = 0;
-    SLINT   d1 = atoi( data1 );
-    SLINT   d2 = atoi( data2 );
-    
-    if ( d2 == 0 )
-    {
-        log_error( "div 0 error" );
-        r = 0;
-    }
-    else
-    {
-        r = d1 / d2;
+    result->type = EST_INT;
+    
+    switch ( code )
+    {
+    case '+':
+        result->type = EST_DOUBLE;
+        result->d = a + b;
+        break;
+    case '-':
+        result->type = EST_DOUBLE;
+        result->d = a - b;
+        break;
+    case '*':
+        result->type = EST_DOUBLE;
+        result->d = a * b;
+        break;
+    case '/':
+        if ( b == 0 )
+        {
+            log_error( "div 0 error" );
+            result->i = 0;
+        }
+        else
+        {
+            result->type = EST_DOUBLE;
+            result->d = a / b;
+        }
+        break;
+    case '>':
+        result->i = ( a > b );
+        break;
+    case '<':
+        result->i = ( a < b );
+        break;
+    case EVAL_GE:
+        result->i = ( a >= b );
+        break;
+    case EVAL_LE:
+        result->i = ( a <= b );
+        break;
+    case EVAL_EQU:
+        result->i = ( a == b );
+        break;
+    case EVAL_NEQ:
+        result->i = ( a != b );
+        break;
+    default:
+        return 0;
     }
     
-    ret = memalloc_zero( 16 );
-    snprintf( ret , 16 , "%d" , r );
-    return ret;
+    return 1;
 }
 
-bchar* evaluate_cmp( bchar* data1 , bchar* data2 , SLINT code )
-{
-    bchar*  ret;
-    bchar*  subret;
-    SLINT   i;
-    SLINT   len;
-    SLINT   flag;
-    SLINT   r;
+/* limbs kept on the stack per operand before falling back to the heap */
+#define EVAL_BIGDEC_LIMBS   64
+
+/* text that is not a decimal number counts as zero */
+UINT32* eval_bigdec_load(
+    EVAL_ARENA* arena   ,
+    BIGDEC*     num     ,
+    bchar*      text    ,
+    UINT32*     buf     ,
+    SLINT       size
+) {
+    UINT32* heap = NULL;
+    SLINT   n;
     
-    ret = memalloc_zero( 4 );
-    subret = evaluate_sub( data1 , data2 );
+    n = bigdec_parse_size( text );
     
-    if ( subret == NULL )
+    if ( n > size )
     {
-        strcpy( ret , "0" );
-        return ret;
+        heap = eval_arena_alloc( arena , sizeof( UINT32 ) * n );
+        buf = heap;
+        size = n;
     }
     
-    len = strlen( subret );
-    
-    flag = 0;
+    bigdec_init( num , buf , size );
     
-    for ( i = 0; i < len; i++ )
+    if ( n >= 0 )
     {
-        if ( ( subret[i] != '0' )
-            && ( subret[i] != '-' )
-            && ( subret[i] != '.' ) )
-        {
-            flag = 1;
-            break;
-        }
+        bigdec_parse( num , text );
     }
     
-    if ( code == '<' )
-    {
-        r = ( ( flag != 0 ) && ( subret[0] == '-' ) );
+    return heap;
+}
+
+/* a op b for the compare operators, by decimal magnitude */
+SLINT eval_text_cmp( EVAL_ARENA* arena , SLINT code , bchar* a , bchar* b )
+{
+    UINT32  abuf[ EVAL_BIGDEC_LIMBS ];
+    UINT32  bbuf[ EVAL_BIGDEC_LIMBS ];
+    UINT32* aheap;
+    UINT32* bheap;
+    BIGDEC  x;
+    BIGDEC  y;
+    SLINT   cmp;
+    SLINT   ret;
+    
+    aheap = eval_bigdec_load( arena , &x , a , abuf , EVAL_BIGDEC_LIMBS );
+    bheap = eval_bigdec_load( arena , &y , b , bbuf , EVAL_BIGDEC_LIMBS );
+    cmp = bigdec_cmp( &x , &y );
+    
+    switch ( code )
+    {
+    case '>':
+        ret = ( cmp > 0 );
+        break;
+    case '<':
+        ret = ( cmp < 0 );
+        break;
+    case EVAL_GE:
+        ret = ( cmp >= 0 );
+        break;
+    case EVAL_LE:
+        ret = ( cmp <= 0 );
+        break;
+    case EVAL_EQU:
+        ret = ( ( cmp == 0 ) && ( strcmp( a , b ) == 0 ) );
+        break;
+    default:
+        ret = ( ( cmp != 0 ) || ( strcmp( a , b ) != 0 ) );
+        break;
+    }
+    
+    eval_arena_free( arena , aheap );
+    eval_arena_free( arena , bheap );
+    return ret;
+}
+
+/*
+exact decimal arithmetic for whatever the int64 path could not take,
+division keeps the larger operand scale and truncates toward zero
+*/
+SLINT eval_text_op(
+    EVAL_ARENA*     arena   ,
+    SLINT           code    ,
+    bchar*          a       ,
+    bchar*          b       ,
+    EVAL_SCALAR*    result
+) {
+    UINT32  abuf[ EVAL_BIGDEC_LIMBS ];
+    UINT32  bbuf[ EVAL_BIGDEC_LIMBS ];
+    UINT32  rbuf[ EVAL_BIGDEC_LIMBS * 2 ];
+    UINT32  sbuf[ EVAL_BIGDEC_LIMBS * 3 ];
+    UINT32* aheap;
+    UINT32* bheap;
+    UINT32* rheap = NULL;
+    UINT32* sheap = NULL;
+    UINT32* scratch = sbuf;
+    BIGDEC  x;
+    BIGDEC  y;
+    BIGDEC  r;
+    SLINT   scale = 0;
+    SLINT   size;
+    SLINT   ssize = 0;
+    bchar*  text;
+    
+    if ( EVAL_IS_CMP( code ) )
+    {
+        result->type = EST_INT;
+        result->i = eval_text_cmp( arena , code , a , b );
+        return 1;
     }
-    else if ( code == '>' )
+    
+    if ( ( code != '+' ) && ( code != '-' ) && ( code != '*' )
+        && ( code != '/' ) )
     {
-        r = ( ( flag != 0 ) && ( subret[0] != '-' ) );
+        return 0;
     }
-    else if ( code == EVAL_GE )
+    
+    aheap = eval_bigdec_load( arena , &x , a , abuf , EVAL_BIGDEC_LIMBS );
+    bheap = eval_bigdec_load( arena , &y , b , bbuf , EVAL_BIGDEC_LIMBS );
+    
+    if ( ( code == '/' ) && bigdec_is_zero( &y ) )
     {
-        /* >= */
-        r = ( ( flag == 0 ) || ( subret[0] != '-' ) );
+        log_error( "div 0 error" );
+        result->type = EST_INT;
+        result->i = 0;
     }
-    else if ( code == EVAL_LE )
+    else
     {
-        /* <= */
-        r = ( ( flag == 0 ) || ( subret[0] == '-' ) );
+        if ( code == '*' )
+        {
+            size = bigdec_mul_size( &x , &y );
+            ssize = bigdec_mul_scratch( &x , &y );
+        }
+        else if ( code == '/' )
+        {
+            scale = MAX( x.scale , y.scale );
+            size = bigdec_div_size( &x , &y , scale );
+            ssize = bigdec_div_scratch( &x , &y , scale );
+        }
+        else
+        {
+            size = bigdec_add_size( &x , &y );
+        }
+        
+        if ( size > EVAL_BIGDEC_LIMBS * 2 )
+        {
+            rheap = eval_arena_alloc( arena , sizeof( UINT32 ) * size );
+        }
+        
+        if ( ssize > EVAL_BIGDEC_LIMBS * 3 )
+        {
+            sheap = eval_arena_alloc( arena , sizeof( UINT32 ) * ssize );
+            scratch = sheap;
+        }
+        
+        bigdec_init( &r , rheap ? rheap : rbuf , MAX( size , EVAL_BIGDEC_LIMBS * 2 ) );
+        
+        if ( code == '+' )
+        {
+            bigdec_add( &r , &x , &y );
+        }
+        else if ( code == '-' )
+        {
+            bigdec_sub( &r , &x , &y );
+        }
+        else if ( code == '*' )
+        {
+            bigdec_mul( &r , &x , &y , scratch );
+        }
+        else
+        {
+            bigdec_div( &r , &x , &y , scale , scratch );
+        }
+        
+        size = bigdec_format_size( &r );
+        text = eval_arena_alloc( arena , size );
+        bigdec_format( &r , text , size );
+        eval_scalar_set_text( result , text , 0 );
     }
-    else if ( code == EVAL_EQU )
+    
+    eval_arena_free( arena , aheap );
+    eval_arena_free( arena , bheap );
+    eval_arena_free( arena , rheap );
+    eval_arena_free( arena , sheap );
+    return 1;
+}
+
+/*
+left op right, integers stay in int64 while they fit, doubles only come
+from double operands, everything else goes through the decimal strings
+*/
+SLINT eval_binop(
+    EVAL_ARENA*     arena   ,
+    SLINT           code    ,
+    EVAL_SCALAR*    left    ,
+    EVAL_SCALAR*    right   ,
+    EVAL_SCALAR*    result
+) {
+    double  d1;
+    double  d2;
+    bchar   lbuf[32];
+    bchar   rbuf[32];
+    
+    memset( result , 0 , sizeof( EVAL_SCALAR ) );
+    
+    if ( ( left->type == EST_INT ) && ( right->type == EST_INT ) )
     {
-        r = ( ( flag == 0 ) && ( strcmp( data1 , data2 ) == 0 ) );
+        if ( eval_int_op( code , left->i , right->i , result ) )
+        {
+            return 1;
+        }
     }
-    else if ( code == EVAL_NEQ )
+    else if ( ( ( left->type == EST_DOUBLE ) || ( right->type == EST_DOUBLE ) )
+        && eval_to_double( left , &d1 )
+        && eval_to_double( right , &d2 ) )
     {
-        r = ( ( flag != 0 ) || ( strcmp( data1 , data2 ) != 0 ) );
+        return eval_double_op( code , d1 , d2 , result );
     }
     
-    memfree( subret );
-    
-    if ( r )
-    {
-        strcpy( ret , "1" );
-    }
-    else
+    if ( EVAL_IS_CMP( code ) )
     {
-        strcpy( ret , "0" );
+        result->type = EST_INT;
+        result->i = eval_text_cmp(
+            arena ,
+            code ,
+            eval_scalar_cstr( left , lbuf , 32 ) ,
+            eval_scalar_cstr( right , rbuf , 32 )
+        );
+        return 1;
     }
     
-    return ret;
+    return eval_text_op(
+        arena ,
+        code ,
+        eval_scalar_arena_text( left , arena ) ,
+        eval_scalar_arena_text( right , arena ) ,
+        result
+    );
 }
 
 EVAL_VALUE* new_eval_value( SLINT type , void* value )
@@ -1093,6 +1397,11 @@ SLINT stack_downlevel( STACK* stackcode , STACK* stackdata , SLINT code_level )
     bchar*      result;
     SLINT       code;
     SLINT       bContinue;
+    EVAL_SCALAR left;
+    EVAL_SCALAR right;
+    EVAL_SCALAR folded;
+    EVAL_ARENA  arena;
+    SLINT       fold;
     
     ret = NULL;
     curcode = NULL;
@@ -1152,52 +1461,49 @@ SLINT stack_downlevel( STACK* stackcode , STACK* stackdata , SLINT code_level )
         {
             if ( data->type == EVT_NUMBER )
             {
-                switch ( code )
+                eval_scalar_set_text( &left , data->data , 0 );
+                eval_scalar_set_text( &right , preresult->data , 0 );
+                
+                eval_arena_init( &arena );
+                fold = eval_binop( &arena , code , &left , &right , &folded );
+                
+                if ( fold )
+                {
+                    eval_arena_keep( &arena , &folded );
+                }
+                
+                eval_arena_reset( &arena );
+                
+                if ( ! fold )
                 {
-                case '+':
-                    result = evaluate_add( data->data , preresult->data );
-                    break;
-                case '-':
-                    result = evaluate_sub( data->data , preresult->data );
-                    break;
-                case '*':
-                    result = evaluate_mul( data->data , preresult->data );
-                    break;
-                case '/':
-                    result = evaluate_div( data->data , preresult->data );
-                    break;
-                case '>':
-                case '<':
-                case EVAL_GE:
-                case EVAL_LE:
-                case EVAL_EQU:
-                case EVAL_NEQ:
-                    result = evaluate_cmp(
-                        data->data ,
-                        preresult->data ,
-                        code
-                    );
-                    
-                    if ( result[0] == '0' || isempty( stackdata ) )
-                    {
-                        bContinue = 0;
-                    }
-                    else
-                    {
-                        memfree( result );
-                        result = data->data;
-                        data = NULL;
-                    }
-                    break;
-                default:
                     log_error( "error" );
                     bContinue = 0;
                     memfree( preresult->data );
                     memfree( preresult );
                     preresult = NULL;
-                    break;
+                }
+                else if ( EVAL_IS_CMP( code )
+                    && ( folded.i != 0 )
+                    && ! isempty( stackdata ) )
+                {
+                    /* chained compare goes on with the left operand */
+                    result = data->data;
+                    data = NULL;
+                }
+                else
+                {
+                    if ( EVAL_IS_CMP( code ) )
+                    {
+                        bContinue = 0;
+                    }
+                    
+                    result = eval_scalar_detach( &folded );
                 }
                 
+                eval_scalar_free( &left );
+                eval_scalar_free( &right );
+                eval_scalar_free( &folded );
+                
                 if ( data )
                 {
                     memfree( data->data );
@@ -1482,110 +1788,307 @@ EVAL_VALUE* build_evaluate(
     return ret;
 }
 
-bchar* get_eval_value( NODE_PARAM* param , EVAL_VALUE* eval )
+/* instructions and constants needed for an expression tree */
+void eval_prog_measure( EVAL_VALUE* eval , SLINT* count , SLINT* const_count )
 {
-    if ( eval->type == EVT_NUMBER )
-    {
-        return dup_str( eval->data );
-    }
-    else if ( eval->type == EVT_VARIABLE )
+    EVAL_CODE*  code;
+    
+    if ( eval->type != EVT_SUBEVAL )
     {
-        return copy_param_value( param , eval->data );
+        ( *count )++;
+        ( *const_count )++;
+        return;
     }
-    else
+    
+    for ( code = ( EVAL_CODE* )eval->data; code != NULL; code = code->next )
     {
-        return run_evaluate( param , eval );
+        eval_prog_measure( &code->value , count , const_count );
+        
+        if ( code != ( EVAL_CODE* )eval->data )
+        {
+            ( *count )++;
+        }
     }
 }
 
-bchar* run_evaluate( NODE_PARAM* param , EVAL_VALUE* eval )
+void eval_prog_emit( EVAL_PROG* prog , SLINT op , SLINT arg )
 {
-    bchar*      result;
-    bchar*      data;
-    bchar*      preresult;
+    prog->code[ prog->count ].op = op;
+    prog->code[ prog->count ].arg = arg;
+    prog->count++;
+}
+
+void eval_prog_const( EVAL_PROG* prog , bchar* text )
+{
+    eval_scalar_set_text(
+        &prog->consts[ prog->const_count ] ,
+        dup_str( text ) ,
+        1
+    );
+    
+    eval_prog_emit( prog , EOP_CONST , prog->const_count++ );
+}
+
+/*
+the first entry of a code list is the running result, every later entry
+is evaluated and combined with it as the left operand
+*/
+SLINT eval_prog_compile(
+    EVAL_PROG*  prog    ,
+    NODE_PARAM* param   ,
+    EVAL_VALUE* eval
+) {
     EVAL_CODE*  code;
+    SLINT       index;
     
     if ( eval->type == EVT_NUMBER )
     {
-        return dup_str( eval->data );
+        eval_prog_const( prog , eval->data );
+        return 1;
     }
     else if ( eval->type == EVT_VARIABLE )
     {
-        return copy_param_value( param , eval->data );
+        index = eval_param_find( param , eval->data );
+        
+        if ( index < 0 )
+        {
+            /* an unknown name reads as itself */
+            eval_prog_const( prog , eval->data );
+        }
+        else
+        {
+            eval_prog_emit( prog , EOP_PARAM , index );
+        }
+        
+        return 1;
     }
     
     code = ( EVAL_CODE* )eval->data;
     
-    if ( code->op != '=' )
+    if ( ( code == NULL ) || ( code->op != '=' ) )
     {
-        return NULL;
+        return 0;
     }
     
-    preresult = get_eval_value( param , &code->value );
-    code = code->next;
+    if ( ! eval_prog_compile( prog , param , &code->value ) )
+    {
+        return 0;
+    }
     
-    while ( code )
+    for ( code = code->next; code != NULL; code = code->next )
     {
-        data = get_eval_value( param , &code->value );
+        if ( ! eval_prog_compile( prog , param , &code->value ) )
+        {
+            return 0;
+        }
         
-        switch ( code->op )
+        if ( code->op == '=' )
+        {
+            eval_prog_emit( prog , EOP_LOAD , 0 );
+        }
+        else if ( EVAL_IS_CMP( code->op ) && ( code->next != NULL ) )
+        {
+            eval_prog_emit( prog , EOP_CHAIN , code->op );
+        }
+        else
+        {
+            eval_prog_emit( prog , EOP_BINOP , code->op );
+        }
+    }
+    
+    return 1;
+}
+
+/* stack slots the program needs, 0 when it is malformed */
+SLINT eval_prog_depth( EVAL_PROG* prog )
+{
+    SLINT   i;
+    SLINT   depth = 0;
+    SLINT   ret = 0;
+    
+    for ( i = 0; i < prog->count; i++ )
+    {
+        switch ( prog->code[i].op )
         {
-        case '=':
-            memfree( preresult );
-            preresult = data;
+        case EOP_CONST:
+            if ( ( prog->code[i].arg < 0 )
+                || ( prog->code[i].arg >= prog->const_count ) )
+            {
+                return 0;
+            }
+            
+            depth++;
+            break;
+        case EOP_PARAM:
+            if ( prog->code[i].arg < 0 )
+            {
+                return 0;
+            }
+            
+            depth++;
             break;
-        case '+':
-            result = evaluate_add( data , preresult );
+        case EOP_BINOP:
+        case EOP_CHAIN:
+        case EOP_LOAD:
+            if ( depth < 2 )
+            {
+                return 0;
+            }
+            
+            depth--;
             break;
-        case '-':
-            result = evaluate_sub( data , preresult );
+        default:
+            return 0;
+        }
+        
+        ret = MAX( ret , depth );
+    }
+    
+    return ( depth == 1 ) ? ret : 0;
+}
+
+EVAL_PROG* compile_evaluate( NODE_PARAM* param , bchar* str )
+{
+    SLINT       pos = 0;
+    SLINT       count = 0;
+    SLINT       const_count = 0;
+    EVAL_VALUE* eval;
+    EVAL_PROG*  prog;
+    
+    eval = build_evaluate( param , str , strlen( str ) , &pos );
+    
+    if ( eval == NULL )
+    {
+        return NULL;
+    }
+    
+    eval_prog_measure( eval , &count , &const_count );
+    
+    prog = memalloc_zero( sizeof( EVAL_PROG ) );
+    prog->code = memalloc_zero( sizeof( EVAL_INST ) * count );
+    prog->consts = memalloc_zero( sizeof( EVAL_SCALAR ) * const_count );
+    
+    if ( eval_prog_compile( prog , param , eval ) )
+    {
+        prog->depth = eval_prog_depth( prog );
+    }
+    
+    free_evaluate( eval );
+    
+    if ( prog->depth == 0 )
+    {
+        free_eval_prog( prog );
+        return NULL;
+    }
+    
+    return prog;
+}
+
+/* stack slots kept on the C stack, deeper programs take theirs from the arena */
+#define EVAL_STACK_SIZE     16
+
+SLINT run_evaluate_scalar(
+    NODE_PARAM*     param   ,
+    EVAL_PROG*      prog    ,
+    EVAL_SCALAR*    result
+) {
+    EVAL_SCALAR     buf[ EVAL_STACK_SIZE ];
+    EVAL_SCALAR*    stack = buf;
+    EVAL_SCALAR*    left;
+    EVAL_SCALAR*    right;
+    EVAL_SCALAR     opresult;
+    EVAL_INST*      inst;
+    EVAL_INST*      end;
+    EVAL_ARENA      arena;
+    SLINT           top = 0;
+    SLINT           ret = 1;
+    
+    eval_arena_init( &arena );
+    
+    if ( prog->depth > EVAL_STACK_SIZE )
+    {
+        stack = eval_arena_alloc( &arena , sizeof( EVAL_SCALAR ) * prog->depth );
+    }
+    
+    end = prog->code + prog->count;
+    
+    for ( inst = prog->code; ret && ( inst < end ); inst++ )
+    {
+        switch ( inst->op )
+        {
+        case EOP_CONST:
+            /* borrowed, the program keeps the text */
+            stack[top] = prog->consts[ inst->arg ];
+            stack[top].owned = 0;
+            top++;
             break;
-        case '*':
-            result = evaluate_mul( data , preresult );
+        case EOP_PARAM:
+            eval_param_index( param , inst->arg , &stack[top] );
+            top++;
             break;
-        case '/':
-            result = evaluate_div( data , preresult );
+        case EOP_LOAD:
+            top--;
+            eval_scalar_free( &stack[ top - 1 ] );
+            stack[ top - 1 ] = stack[top];
             break;
-        case '>':
-        case '<':
-        case EVAL_GE:
-        case EVAL_LE:
-        case EVAL_EQU:
-        case EVAL_NEQ:
-            result = evaluate_cmp( data , preresult , code->op );
+        default:
+            left = &stack[ top - 1 ];
+            right = &stack[ top - 2 ];
+            
+            if ( ! eval_binop( &arena , inst->arg , left , right , &opresult ) )
+            {
+                log_error( "error" );
+                ret = 0;
+                break;
+            }
+            
+            top--;
             
-            if ( result[0] == '0' || ( code->next == NULL ) )
+            if ( ( inst->op == EOP_CHAIN ) && ( opresult.i != 0 ) )
             {
+                /* chained compare goes on with the left operand */
+                eval_scalar_free( &opresult );
+                eval_scalar_free( right );
+                *right = *left;
             }
             else
             {
-                memfree( result );
-                result = data;
-                data = NULL;
+                eval_scalar_free( left );
+                eval_scalar_free( right );
+                *right = opresult;
             }
+            
             break;
-        default:
-            log_error( "error" );
-            memfree( data );
-            memfree( preresult );
-            return NULL;
-        }
-        
-        if ( data )
-        {
-            memfree( data );
         }
-        
-        if ( preresult )
+    }
+    
+    if ( ret )
+    {
+        *result = stack[0];
+        eval_arena_keep( &arena , result );
+    }
+    else
+    {
+        while ( top > 0 )
         {
-            memfree( preresult );
+            eval_scalar_free( &stack[ --top ] );
         }
-        
-        preresult = result;
-        code = code->next;
     }
     
-    return preresult;
+    eval_arena_reset( &arena );
+    return ret;
+}
+
+bchar* run_evaluate( NODE_PARAM* param , EVAL_PROG* prog )
+{
+    EVAL_SCALAR result;
+    
+    if ( ! run_evaluate_scalar( param , prog , &result ) )
+    {
+        return NULL;
+    }
+    
+    return eval_scalar_detach( &result );
 }
 
 void free_evaluate( EVAL_VALUE* eval )
@@ -1605,76 +2108,66 @@ void free_evaluate( EVAL_VALUE* eval )
     }
 }
 
-SLINT dump_evaluate_code( EVAL_CODE* eval , FILE_DESC* pf )
+void free_eval_prog( EVAL_PROG* prog )
 {
-    EVAL_CODE* temp;
-    SLINT count;
-    
-    if ( eval == NULL )
-    {
-        count = 0;
-        filewrite( pf , &count , INT_SIZE );
-        return 1;
-    }
-    
-    count = 0;
-    temp = eval;
+    SLINT   i;
     
-    while ( temp )
+    if ( prog == NULL )
     {
-        count++;
-        temp = temp->next;
+        return;
     }
     
-    filewrite( pf , &count , INT_SIZE );
-    
-    while ( eval )
+    for ( i = 0; i < prog->const_count; i++ )
     {
-        filewrite( pf , &eval->op , INT_SIZE );
-        dump_evaluate( &eval->value , pf );
-        eval = eval->next;
+        eval_scalar_free( &prog->consts[i] );
     }
     
-    return 1;
+    memfree( prog->consts );
+    memfree( prog->code );
+    memfree( prog );
 }
 
-SLINT dump_evaluate( EVAL_VALUE* eval , FILE_DESC* pf )
+SLINT dump_evaluate( EVAL_PROG* prog , FILE_DESC* pf )
 {
-    SLINT count;
+    SLINT   i;
+    SLINT   count;
+    bchar*  text;
     
-    if ( eval == NULL )
+    if ( prog == NULL )
     {
         count = 0;
         filewrite( pf , &count , INT_SIZE );
+        return 1;
     }
-    else
+    
+    filewrite( pf , &prog->count , INT_SIZE );
+    
+    for ( i = 0; i < prog->count; i++ )
     {
-        count = 1;
+        filewrite( pf , &prog->code[i].op , INT_SIZE );
+        filewrite( pf , &prog->code[i].arg , INT_SIZE );
+    }
+    
+    filewrite( pf , &prog->const_count , INT_SIZE );
+    
+    for ( i = 0; i < prog->const_count; i++ )
+    {
+        text = eval_scalar_text( &prog->consts[i] );
+        count = strlen( text );
         filewrite( pf , &count , INT_SIZE );
-        
-        filewrite( pf , &eval->type , INT_SIZE );
-        
-        if ( eval->type == EVT_SUBEVAL )
-        {
-            dump_evaluate_code( ( EVAL_CODE* ) eval->data , pf );
-        }
-        else
-        {
-            count = strlen( eval->data );
-            filewrite( pf , &count , INT_SIZE );
-            filewrite( pf , eval->data , count );
-        }
+        filewrite( pf , text , count );
     }
     
     return 1;
 }
 
-EVAL_CODE* load_evaluate_code( FILE_DESC* pf , SLINT* haverror )
+EVAL_PROG* load_evaluate( FILE_DESC* pf , SLINT* haverror )
 {
-    SLINT       i;
+    EVAL_PROG*  prog;
     SLINT       count;
-    EVAL_CODE*  ret;
-    EVAL_CODE*  cur;
+    SLINT       size;
+    SLINT       i;
+    bchar*      text;
     
     if ( fileread( pf , &count , INT_SIZE ) != INT_SIZE )
     {
@@ -1687,103 +2180,134 @@ EVAL_CODE* load_evaluate_code( FILE_DESC* pf , SLINT* haverror )
         return NULL;
     }
     
-    ret = NULL;
-    cur = NULL;
+    if ( count < 0 )
+    {
+        *haverror = 1;
+        return NULL;
+    }
+    
+    prog = memalloc_zero( sizeof( EVAL_PROG ) );
+    prog->code = memalloc_zero( sizeof( EVAL_INST ) * count );
     
     for ( i = 0; i < count; i++ )
     {
-        if ( cur == NULL )
+        if ( ( fileread( pf , &prog->code[i].op , INT_SIZE ) != INT_SIZE )
+            || ( fileread( pf , &prog->code[i].arg , INT_SIZE ) != INT_SIZE ) )
         {
-            ret = memalloc_zero( sizeof( EVAL_CODE ) );
-            cur = ret;
-        }
-        else
-        {
-            cur->next = memalloc_zero( sizeof( EVAL_CODE ) );
-            cur = cur->next;
+            *haverror = 1;
+            free_eval_prog( prog );
+            return NULL;
         }
-        
-        if ( fileread( pf , &cur->op , INT_SIZE ) != INT_SIZE )
+    }
+    
+    prog->count = count;
+    
+    if ( ( fileread( pf , &count , INT_SIZE ) != INT_SIZE ) || ( count < 0 ) )
+    {
+        *haverror = 1;
+        free_eval_prog( prog );
+        return NULL;
+    }
+    
+    prog->consts = memalloc_zero( sizeof( EVAL_SCALAR ) * count );
+    
+    for ( i = 0; i < count; i++ )
+    {
+        if ( ( fileread( pf , &size , INT_SIZE ) != INT_SIZE ) || ( size < 0 ) )
         {
             *haverror = 1;
-            free_stack_code( ret );
+            free_eval_prog( prog );
             return NULL;
         }
         
-        EVAL_VALUE* value = load_evaluate( pf , haverror );
+        text = memalloc_zero( size + 1 );
         
-        if ( value == NULL || *haverror )
+        if ( ( size > 0 ) && ( fileread( pf , text , size ) != size ) )
         {
             *haverror = 1;
-            free_stack_code( ret );
+            memfree( text );
+            free_eval_prog( prog );
             return NULL;
         }
         
-        cur->value.type = value->type;
-        cur->value.data = value->data;
-        memfree( value );
+        eval_scalar_set_text( &prog->consts[i] , text , 1 );
+        prog->const_count++;
     }
     
-    return ret;
-}
-
-EVAL_VALUE* load_evaluate( FILE_DESC* pf , SLINT* haverror )
-{
-    EVAL_VALUE* ret;
-    SLINT       count;
+    prog->depth = eval_prog_depth( prog );
     
-    if ( fileread( pf , &count ,INT_SIZE ) != INT_SIZE )
+    if ( prog->depth == 0 )
     {
         *haverror = 1;
+        free_eval_prog( prog );
         return NULL;
     }
     
-    if ( count == 0 )
+    return prog;
+}
+
+SLINT dump_strformat( EVAL_FORMAT* format , FILE_DESC* pf )
+{
+    SLINT   i;
+    
+    filewrite( pf , &format->count , INT_SIZE );
+    
+    for ( i = 0; i < format->count; i++ )
     {
-        return NULL;
+        filewrite( pf , &format->seg[i].type , INT_SIZE );
+        filewrite( pf , &format->seg[i].index , INT_SIZE );
+        filewrite( pf , &format->seg[i].len , INT_SIZE );
+        filewrite( pf , format->seg[i].text , format->seg[i].len );
     }
     
-    ret = memalloc_zero( sizeof( EVAL_VALUE ) );
+    return 1;
+}
+
+EVAL_FORMAT* load_strformat( FILE_DESC* pf , SLINT* haverror )
+{
+    EVAL_FORMAT*    format;
+    EVAL_SEGMENT*   seg;
+    SLINT           count;
+    SLINT           i;
     
-    if ( fileread( pf , &ret->type , INT_SIZE ) != INT_SIZE )
+    if ( ( fileread( pf , &count , INT_SIZE ) != INT_SIZE ) || ( count < 0 ) )
     {
         *haverror = 1;
-        free_evaluate( ret );
         return NULL;
     }
     
-    if ( ret->type == EVT_SUBEVAL )
+    format = memalloc_zero( sizeof( EVAL_FORMAT ) );
+    
+    if ( count > 0 )
     {
-        ret->data = ( char* )load_evaluate_code( pf , haverror );
-        
-        if ( *haverror )
-        {
-            free_evaluate( ret );
-            return NULL;
-        }
+        format->seg = memalloc_zero( sizeof( EVAL_SEGMENT ) * count );
     }
-    else
+    
+    for ( i = 0; i < count; i++ )
     {
-        if ( fileread( pf , &count , INT_SIZE ) != INT_SIZE )
+        seg = &format->seg[i];
+        
+        if ( ( fileread( pf , &seg->type , INT_SIZE ) != INT_SIZE )
+            || ( fileread( pf , &seg->index , INT_SIZE ) != INT_SIZE )
+            || ( fileread( pf , &seg->len , INT_SIZE ) != INT_SIZE )
+            || ( ( seg->type != ESG_TEXT ) && ( seg->type != ESG_PARAM ) )
+            || ( seg->len < 0 ) )
         {
             *haverror = 1;
-            free_evaluate( ret );
+            free_strformat( format );
             return NULL;
         }
         
-        if ( count > 0 )
+        seg->text = memalloc_zero( seg->len + 1 );
+        format->count++;
+        
+        if ( fileread( pf , seg->text , seg->len ) != seg->len )
         {
-            ret->data = memalloc_zero( count + 1 );
-            
-            if ( fileread( pf , ret->data , count ) != count )
-            {
-                *haverror = 1;
-                free_evaluate( ret );
-                return NULL;
-            }
+            *haverror = 1;
+            free_strformat( format );
+            return NULL;
         }
     }
     
-    return ret;
+    return format;
 }
-
@@ -49,10 +49,99 @@ struct _EVAL_CODE
     EVAL_CODE*  next;
 };
 
+enum EVAL_SCALAR_TYPE
+{
+    EST_TEXT ,
+    EST_INT ,
+    EST_DOUBLE
+};
+
+/* operand or result of an expression, text is only made when read */
+typedef struct _EVAL_SCALAR
+{
+    SLINT       type;
+    INT64       i;
+    double      d;
+    bchar*      text;
+    SLINT       owned;  /* text is freed with the scalar */
+}
+EVAL_SCALAR;
+
+enum EVAL_OP
+{
+    EOP_CONST ,     /* push consts[arg] */
+    EOP_PARAM ,     /* push the value of parameter arg */
+    EOP_BINOP ,     /* pop the operand, apply operator arg to it and the */
+                    /* running result below it */
+    EOP_CHAIN ,     /* compare that hands its operand on while true */
+    EOP_LOAD        /* the operand replaces the running result */
+};
+
+typedef struct _EVAL_INST
+{
+    SLINT       op;     /* EVAL_OP */
+    SLINT       arg;
+}
+EVAL_INST;
+
+/* expression compiled to postfix, variables resolved to parameter slots */
+typedef struct _EVAL_PROG
+{
+    EVAL_INST*      code;
+    SLINT           count;
+    EVAL_SCALAR*    consts;
+    SLINT           const_count;
+    SLINT           depth;  /* value stack slots it needs */
+}
+EVAL_PROG;
+
+enum EVAL_SEGMENT_TYPE
+{
+    ESG_TEXT ,
+    ESG_PARAM
+};
+
+typedef struct _EVAL_SEGMENT
+{
+    SLINT       type;   /* EVAL_SEGMENT_TYPE */
+    SLINT       index;  /* parameter slot of ESG_PARAM */
+    bchar*      text;   /* literal, or the name shown when the slot has no text */
+    SLINT       len;
+}
+EVAL_SEGMENT;
+
+/* format string split into literal runs and parameter slots */
+typedef struct _EVAL_FORMAT
+{
+    EVAL_SEGMENT*   seg;
+    SLINT           count;
+}
+EVAL_FORMAT;
+
+void eval_scalar_free( EVAL_SCALAR* scalar );
+
+bchar* eval_scalar_text( EVAL_SCALAR* scalar );
+
+bchar* eval_scalar_detach( EVAL_SCALAR* scalar );
+
+SLINT eval_scalar_truth( EVAL_SCALAR* scalar );
+
 char* strformat( NODE_PARAM* param , char* value );
 
+EVAL_FORMAT* compile_strformat( NODE_PARAM* param , char* value );
+
+char* run_strformat( NODE_PARAM* param , EVAL_FORMAT* format , SLINT* len );
+
+void free_strformat( EVAL_FORMAT* format );
+
+SLINT dump_strformat( EVAL_FORMAT* format , FILE_DESC* pf );
+
+EVAL_FORMAT* load_strformat( FILE_DESC* pf , SLINT* haverror );
+
 char* evaluate( NODE_PARAM* param , char* str );
 
+SLINT evaluate_scalar( NODE_PARAM* param , char* str , EVAL_SCALAR* result );
+
 EVAL_VALUE* build_evaluate(
     NODE_PARAM* param   ,
     char*       str     ,
@@ -60,15 +149,25 @@ EVAL_VALUE* build_evaluate(
     SLINT*      pos
 );
 
+EVAL_PROG* compile_evaluate( NODE_PARAM* param , char* str );
+
 bchar* run_evaluate(
     NODE_PARAM* param ,
-    EVAL_VALUE* eval
+    EVAL_PROG*  prog
+);
+
+SLINT run_evaluate_scalar(
+    NODE_PARAM*     param   ,
+    EVAL_PROG*      prog    ,
+    EVAL_SCALAR*    result
 );
 
 void free_evaluate( EVAL_VALUE* eval );
 
-SLINT dump_evaluate( EVAL_VALUE* eval , FILE_DESC* pf );
+void free_eval_prog( EVAL_PROG* prog );
+
+SLINT dump_evaluate( EVAL_PROG* prog , FILE_DESC* pf );
 
-EVAL_VALUE* load_evaluate( FILE_DESC* pf , SLINT* haverror );
+EVAL_PROG* load_evaluate( FILE_DESC* pf , SLINT* haverror );
 
 #endif
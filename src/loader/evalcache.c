@@ -0,0 +1,317 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#define MEMALLOC_CATEGORY   MEMCAT_EVAL
+
+#include "logger.h"
+#include "errorstr.h"
+#include "memalloc.h"
+#include "evalcache.h"
+
+#include <string.h>
+
+EVAL_CACHE* new_eval_cache( SLINT size )
+{
+    EVAL_CACHE* ret;
+    
+    ret = memalloc_zero( sizeof( EVAL_CACHE ) );
+    ret->size = size;
+    ret->bucket_count = 16;
+    
+    while ( ret->bucket_count < ( UINT )size )
+    {
+        ret->bucket_count <<= 1;
+    }
+    
+    ret->bucket = memalloc_zero(
+        sizeof( EVAL_CACHE_ENTRY* ) * ret->bucket_count
+    );
+    
+    return ret;
+}
+
+static UINT eval_cache_hash(
+    PARAM_ITEM*     layout  ,
+    SLINT           kind    ,
+    bchar*          str     ,
+    SLINT*          len
+) {
+    UINT    hash;
+    bchar*  p;
+    
+    /* fnv-1a over the text, seeded with the parameter list and kind */
+    hash = 2166136261u ^ ( UINT )( ( intptr_t )layout >> 4 ) ^ ( UINT )kind;
+    
+    for ( p = str; *p; p++ )
+    {
+        hash = ( hash ^ ( unsigned char )*p ) * 16777619u;
+    }
+    
+    *len = p - str;
+    return hash;
+}
+
+static void eval_cache_unlink( EVAL_CACHE* cache , EVAL_CACHE_ENTRY* entry )
+{
+    if ( entry->prev )
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        cache->head = entry->next;
+    }
+    
+    if ( entry->next )
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        cache->tail = entry->prev;
+    }
+}
+
+static void eval_cache_push_front( EVAL_CACHE* cache , EVAL_CACHE_ENTRY* entry )
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    
+    if ( cache->head )
+    {
+        cache->head->prev = entry;
+    }
+    else
+    {
+        cache->tail = entry;
+    }
+    
+    cache->head = entry;
+}
+
+static void eval_cache_free_entry( EVAL_CACHE_ENTRY* entry )
+{
+    free_eval_prog( entry->prog );
+    free_strformat( entry->format );
+    memfree( entry->text );
+    memfree( entry );
+}
+
+/* drop the least recently used entry */
+static void eval_cache_evict( EVAL_CACHE* cache )
+{
+    EVAL_CACHE_ENTRY*   entry;
+    EVAL_CACHE_ENTRY**  link;
+    
+    entry = cache->tail;
+    
+    if ( entry == NULL )
+    {
+        return;
+    }
+    
+    eval_cache_unlink( cache , entry );
+    link = &cache->bucket[ entry->hash & ( cache->bucket_count - 1 ) ];
+    
+    while ( *link != entry )
+    {
+        link = &( *link )->chain;
+    }
+    
+    *link = entry->chain;
+    eval_cache_free_entry( entry );
+    cache->count--;
+}
+
+void eval_cache_clear( EVAL_CACHE* cache )
+{
+    EVAL_CACHE_ENTRY*   entry;
+    EVAL_CACHE_ENTRY*   next;
+    
+    for ( entry = cache->head; entry != NULL; entry = next )
+    {
+        next = entry->next;
+        eval_cache_free_entry( entry );
+    }
+    
+    memset( cache->bucket , 0 , sizeof( EVAL_CACHE_ENTRY* ) * cache->bucket_count );
+    cache->head = NULL;
+    cache->tail = NULL;
+    cache->count = 0;
+}
+
+void free_eval_cache( EVAL_CACHE* cache )
+{
+    if ( cache == NULL )
+    {
+        return;
+    }
+    
+    eval_cache_clear( cache );
+    memfree( cache->bucket );
+    memfree( cache );
+}
+
+static EVAL_CACHE_ENTRY* eval_cache_find(
+    EVAL_CACHE*     cache   ,
+    NODE_PARAM*     param   ,
+    SLINT           kind    ,
+    bchar*          str     ,
+    UINT*           hash    ,
+    SLINT*          len
+) {
+    EVAL_CACHE_ENTRY*   entry;
+    
+    /* param is a copy on the caller's stack, the node's list is not */
+    *hash = eval_cache_hash( param->list , kind , str , len );
+    entry = cache->bucket[ *hash & ( cache->bucket_count - 1 ) ];
+    
+    for ( ; entry != NULL; entry = entry->chain )
+    {
+        if ( ( entry->hash == *hash )
+            && ( entry->len == *len )
+            && ( entry->layout == param->list )
+            && ( entry->kind == kind )
+            && ( memcmp( entry->text , str , *len ) == 0 ) )
+        {
+            cache->hits++;
+            
+            if ( entry != cache->head )
+            {
+                eval_cache_unlink( cache , entry );
+                eval_cache_push_front( cache , entry );
+            }
+            
+            return entry;
+        }
+    }
+    
+    cache->misses++;
+    return NULL;
+}
+
+static EVAL_CACHE_ENTRY* eval_cache_insert(
+    EVAL_CACHE*     cache   ,
+    NODE_PARAM*     param   ,
+    SLINT           kind    ,
+    bchar*          str     ,
+    UINT            hash    ,
+    SLINT           len
+) {
+    EVAL_CACHE_ENTRY*   entry;
+    UINT                index;
+    
+    if ( cache->count >= cache->size )
+    {
+        eval_cache_evict( cache );
+    }
+    
+    index = hash & ( cache->bucket_count - 1 );
+    entry = memalloc_zero( sizeof( EVAL_CACHE_ENTRY ) );
+    entry->layout = param->list;
+    entry->kind = kind;
+    entry->hash = hash;
+    entry->len = len;
+    entry->text = dup_str( str );
+    entry->chain = cache->bucket[index];
+    cache->bucket[index] = entry;
+    eval_cache_push_front( cache , entry );
+    cache->count++;
+    
+    return entry;
+}
+
+static EVAL_PROG* eval_cache_get(
+    EVAL_CACHE*     cache   ,
+    NODE_PARAM*     param   ,
+    bchar*          str
+) {
+    EVAL_CACHE_ENTRY*   entry;
+    EVAL_PROG*          prog;
+    UINT                hash;
+    SLINT               len;
+    
+    entry = eval_cache_find( cache , param , ECK_PROG , str , &hash , &len );
+    
+    if ( entry != NULL )
+    {
+        return entry->prog;
+    }
+    
+    prog = compile_evaluate( param , str );
+    
+    /* text that does not compile is not kept, it fails the same way */
+    if ( prog == NULL )
+    {
+        return NULL;
+    }
+    
+    entry = eval_cache_insert( cache , param , ECK_PROG , str , hash , len );
+    entry->prog = prog;
+    
+    return prog;
+}
+
+SLINT eval_cache_run(
+    EVAL_CACHE*     cache   ,
+    NODE_PARAM*     param   ,
+    bchar*          str     ,
+    EVAL_SCALAR*    result
+) {
+    EVAL_PROG*  prog;
+    
+    prog = eval_cache_get( cache , param , str );
+    
+    if ( prog == NULL )
+    {
+        log_error( ERROR_EVAL );
+        memset( result , 0 , sizeof( EVAL_SCALAR ) );
+        result->type = EST_INT;
+        return 1;
+    }
+    
+    return run_evaluate_scalar( param , prog , result );
+}
+
+bchar* eval_cache_format(
+    EVAL_CACHE*     cache   ,
+    NODE_PARAM*     param   ,
+    bchar*          str     ,
+    SLINT*          len
+) {
+    EVAL_CACHE_ENTRY*   entry;
+    EVAL_FORMAT*        format;
+    UINT                hash;
+    SLINT               size;
+    
+    entry = eval_cache_find( cache , param , ECK_FORMAT , str , &hash , &size );
+    
+    if ( entry != NULL )
+    {
+        return run_strformat( param , entry->format , len );
+    }
+    
+    format = compile_strformat( param , str );
+    
+    if ( format == NULL )
+    {
+        return NULL;
+    }
+    
+    entry = eval_cache_insert( cache , param , ECK_FORMAT , str , hash , size );
+    entry->format = format;
+    
+    return run_strformat( param , format , len );
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#ifndef __LOADER_EVALCACHE_H_INCLUDED__
+#define __LOADER_EVALCACHE_H_INCLUDED__
+
+#include "slang.h"
+#include "eval.h"
+
+/* programs and format templates kept per runtime for text only known late */
+#define EVAL_CACHE_SIZE         256
+
+enum EVAL_CACHE_KIND
+{
+    ECK_PROG ,
+    ECK_FORMAT
+};
+
+typedef struct _EVAL_CACHE_ENTRY    EVAL_CACHE_ENTRY;
+
+struct _EVAL_CACHE_ENTRY
+{
+    PARAM_ITEM*         layout; /* node's list the slots were resolved */
+                                /* against, not the per-call copy */
+    SLINT               kind;   /* EVAL_CACHE_KIND */
+    UINT                hash;
+    SLINT               len;
+    bchar*              text;
+    EVAL_PROG*          prog;
+    EVAL_FORMAT*        format;
+    EVAL_CACHE_ENTRY*   chain;  /* next in the bucket */
+    EVAL_CACHE_ENTRY*   prev;   /* toward the most recently used */
+    EVAL_CACHE_ENTRY*   next;
+};
+
+typedef struct _EVAL_CACHE          EVAL_CACHE;
+
+struct _EVAL_CACHE
+{
+    EVAL_CACHE_ENTRY**  bucket;
+    UINT                bucket_count;   /* power of two */
+    SLINT               count;
+    SLINT               size;
+    EVAL_CACHE_ENTRY*   head;           /* most recently used */
+    EVAL_CACHE_ENTRY*   tail;
+    UINT64              hits;
+    UINT64              misses;
+};
+
+EVAL_CACHE* new_eval_cache( SLINT size );
+
+void eval_cache_clear( EVAL_CACHE* cache );
+
+void free_eval_cache( EVAL_CACHE* cache );
+
+/*
+evaluate str in the slots of param through the cache, the result text may
+borrow from a cached program until the next call
+*/
+SLINT eval_cache_run(
+    EVAL_CACHE*     cache   ,
+    NODE_PARAM*     param   ,
+    bchar*          str     ,
+    EVAL_SCALAR*    result
+);
+
+/*
+format str with the slots of param through the cache, NULL if it fails,
+a template is kept per node like a program, never per call
+*/
+bchar* eval_cache_format(
+    EVAL_CACHE*     cache   ,
+    NODE_PARAM*     param   ,
+    bchar*          str     ,
+    SLINT*          len
+);
+
+#endif
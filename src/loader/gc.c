@@ -0,0 +1,622 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#define MEMALLOC_CATEGORY   MEMCAT_VALUE
+
+#include "logger.h"
+#include "memalloc.h"
+#include "mem.h"
+#include "gc.h"
+
+#include <string.h>
+
+/*
+trial deletion after Bacon and Rajan: a table whose count drops to a value
+above 0 may be the entry to a dead cycle, so it is buffered, a pass takes
+candidates from the buffer oldest first together with every table they
+reach, counts the references between those members, and a member none of
+whose references come from outside, directly or through another member,
+was only held from inside the group
+
+the counts are kept beside the members and ref itself is never touched, so
+a pass can stop at the budget and go on at the next call: a member whose
+ref changes meanwhile is simply taken as held, and a member freed meanwhile
+holds on to the tables it still refers to until the pass is over
+*/
+
+GC_STATE* new_gc_state()
+{
+    return memalloc_zero( sizeof( GC_STATE ) );
+}
+
+void free_gc_state( GC_STATE* gc )
+{
+    if ( gc == NULL )
+    {
+        return;
+    }
+    
+    memfree( gc->root );
+    memfree( gc->member );
+    memfree( gc->work );
+    memfree( gc->garbage );
+    memfree( gc );
+}
+
+static void gc_append( RT_VALUE*** list , SLINT* count , SLINT* size , RT_VALUE* value )
+{
+    RT_VALUE**  grown;
+    
+    if ( *count >= *size )
+    {
+        *size = ( *size > 0 ) ? *size * 2 : 64;
+        grown = memalloc( sizeof( RT_VALUE* ) * ( *size ) );
+        
+        if ( *count > 0 )
+        {
+            memcpy( grown , *list , sizeof( RT_VALUE* ) * ( *count ) );
+        }
+        
+        memfree( *list );
+        *list = grown;
+    }
+    
+    ( *list )[ ( *count )++ ] = value;
+}
+
+static void gc_push( GC_STATE* gc , RT_VALUE* value )
+{
+    gc_append( &gc->work , &gc->work_count , &gc->work_size , value );
+}
+
+static RT_VALUE* gc_pop( GC_STATE* gc )
+{
+    if ( gc->work_count == 0 )
+    {
+        return NULL;
+    }
+    
+    return gc->work[ --gc->work_count ];
+}
+
+static void gc_set_color( RT_VALUE* value , UINT color )
+{
+    value->gc = ( value->gc & ~GC_COLOR_MASK ) | color;
+}
+
+#define GC_COLOR( value )       ( ( value )->gc & GC_COLOR_MASK )
+#define GC_INDEX( value )       ( ( value )->gc >> GC_INDEX_SHIFT )
+
+/* a table left out of a full pass only counts as a holder from outside */
+#define GC_MEMBER_MAX           ( ( SLINT )( ( UINT )-1 >> GC_INDEX_SHIFT ) )
+
+/* the next table item of iter, NULL when there are no more */
+static RT_VALUE* gc_next_table( HFMAP map , FMAP_ITER* iter )
+{
+    char*       key;
+    RT_VALUE*   item;
+    
+    while ( fmap_iter_next( map , iter , &key , ( void** )&item ) )
+    {
+        /* unloaded items hold no count, so they are never part of it */
+        if ( ( item != NULL ) && ( item->type == RVT_TABLE ) )
+        {
+            return item;
+        }
+    }
+    
+    return NULL;
+}
+
+static void gc_admit( GC_STATE* gc , RT_VALUE* value , SLINT count )
+{
+    GC_MEMBER*  grown;
+    
+    if ( gc->member_count >= gc->member_size )
+    {
+        gc->member_size = ( gc->member_size > 0 ) ? gc->member_size * 2 : 64;
+        grown = memalloc( sizeof( GC_MEMBER ) * gc->member_size );
+        
+        if ( gc->member_count > 0 )
+        {
+            memcpy( grown , gc->member , sizeof( GC_MEMBER ) * gc->member_count );
+        }
+        
+        memfree( gc->member );
+        gc->member = grown;
+    }
+    
+    gc->member[ gc->member_count ].value = value;
+    gc->member[ gc->member_count ].count = count;
+    value->gc = ( value->gc & GC_BUFFERED )
+        | GC_GRAY
+        | ( ( UINT )gc->member_count << GC_INDEX_SHIFT );
+    gc->member_count++;
+}
+
+/* a member known to be reachable from outside, its items are walked later */
+static void gc_hold( GC_STATE* gc , RT_VALUE* value )
+{
+    if ( ! ( value->gc & GC_HELD ) )
+    {
+        value->gc |= GC_HELD;
+        gc_push( gc , value );
+    }
+}
+
+static void gc_touch( GC_STATE* gc , RT_VALUE* value )
+{
+    value->gc |= GC_TOUCHED;
+    gc_hold( gc , value );
+}
+
+/* take candidates from the buffer, the oldest first */
+static void gc_begin( RUNTIME* runtime , SLINT budget , SLINT* spent )
+{
+    GC_STATE*   gc = runtime->gc;
+    RT_VALUE*   value;
+    
+    while ( ( gc->root_head < gc->root_count )
+        && ( gc->member_count < GC_MEMBER_MAX )
+        && ( ( budget <= 0 ) || ( *spent < budget ) ) )
+    {
+        value = gc->root[ gc->root_head++ ];
+        value->gc &= ~GC_BUFFERED;
+        ( *spent )++;
+        
+        if ( value->gc & GC_DEAD )
+        {
+            dealloc_value( runtime , value );
+        }
+        else if ( GC_COLOR( value ) == GC_PURPLE )
+        {
+            gc_admit( gc , value , value->ref );
+        }
+    }
+    
+    if ( gc->root_head >= gc->root_count )
+    {
+        gc->root_head = 0;
+        gc->root_count = 0;
+    }
+    
+    if ( gc->member_count > 0 )
+    {
+        gc->member_roots = gc->member_count;
+        gc->phase = GC_MARK;
+        gc->next = 0;
+    }
+}
+
+/* walk every member once, taking in the tables they hold */
+static void gc_mark( GC_STATE* gc , SLINT budget , SLINT* spent )
+{
+    RT_VALUE*   value;
+    RT_VALUE*   item;
+    
+    while ( ( budget <= 0 ) || ( *spent < budget ) )
+    {
+        if ( gc->walking == NULL )
+        {
+            if ( gc->next >= gc->member_count )
+            {
+                gc->phase = GC_SCAN;
+                gc->next = 0;
+                return;
+            }
+            
+            value = gc->member[ gc->next++ ].value;
+            ( *spent )++;
+            
+            if ( ! ( value->gc & GC_DEAD ) )
+            {
+                fmap_iter_init( value->data , &gc->iter );
+                gc->walking = value;
+            }
+            
+            continue;
+        }
+        
+        item = gc_next_table( gc->walking->data , &gc->iter );
+        
+        if ( item == NULL )
+        {
+            gc->walking = NULL;
+            continue;
+        }
+        
+        ( *spent )++;
+        
+        if ( GC_COLOR( item ) == GC_GRAY )
+        {
+            gc->member[ GC_INDEX( item ) ].count--;
+        }
+        else if ( gc->member_count < GC_MEMBER_MAX )
+        {
+            gc_admit( gc , item , ( SLINT )item->ref - 1 );
+        }
+    }
+}
+
+/* hold the members with refs from outside and whatever they reach */
+static void gc_scan( GC_STATE* gc , SLINT budget , SLINT* spent )
+{
+    GC_MEMBER*  member;
+    RT_VALUE*   value;
+    RT_VALUE*   item;
+    
+    while ( ( budget <= 0 ) || ( *spent < budget ) )
+    {
+        if ( gc->walking != NULL )
+        {
+            item = gc_next_table( gc->walking->data , &gc->iter );
+            
+            if ( item == NULL )
+            {
+                gc->walking = NULL;
+            }
+            else
+            {
+                ( *spent )++;
+                
+                if ( GC_COLOR( item ) == GC_GRAY )
+                {
+                    gc_hold( gc , item );
+                }
+            }
+        }
+        else if ( ( value = gc_pop( gc ) ) != NULL )
+        {
+            ( *spent )++;
+            
+            if ( ! ( value->gc & GC_DEAD ) )
+            {
+                fmap_iter_init( value->data , &gc->iter );
+                gc->walking = value;
+            }
+        }
+        else if ( gc->next < gc->member_count )
+        {
+            member = &gc->member[ gc->next++ ];
+            ( *spent )++;
+            
+            if ( member->count > 0 )
+            {
+                gc_hold( gc , member->value );
+            }
+        }
+        else
+        {
+            gc->phase = GC_DONE;
+            return;
+        }
+    }
+}
+
+/*
+links inside the group are dropped without counting, anything else the
+tables hold is released the usual way
+*/
+static SLINT gc_free_item( char* key , RT_VALUE* item , RUNTIME* runtime )
+{
+    if ( item == NULL )
+    {
+        return 1;
+    }
+    
+    /* the group may already be emptied, so go by the flag not the type */
+    if ( item->gc & GC_GARBAGE )
+    {
+        runtime->total_ref--;
+        return 1;
+    }
+    
+    unref_value( runtime , item );
+    return 1;
+}
+
+static void gc_free_garbage( RUNTIME* runtime )
+{
+    GC_STATE*   gc = runtime->gc;
+    RT_VALUE*   value;
+    INT64       live;
+    SLINT       i;
+    
+    live = runtime->mem->live;
+    
+    for ( i = 0; i < gc->garbage_count; i++ )
+    {
+        value = gc->garbage[i];
+        update_value( runtime , value );
+        fmap_release( value->data , ( FMAP_CALLBACK )gc_free_item , runtime );
+        value->data = NULL;
+        value->type = RVT_NULL;
+    }
+    
+    for ( i = 0; i < gc->garbage_count; i++ )
+    {
+        value = gc->garbage[i];
+        
+        /* the buffer still points at it, the shell goes when it is taken */
+        if ( value->gc & GC_BUFFERED )
+        {
+            value->gc = GC_BUFFERED | GC_DEAD;
+        }
+        else
+        {
+            dealloc_value( runtime , value );
+        }
+    }
+    
+    gc->tables += gc->garbage_count;
+    gc->bytes += live - runtime->mem->live;
+    gc->garbage_count = 0;
+}
+
+/* the garbage members reachable from value, which is one of them */
+static void gc_take_group( GC_STATE* gc , RT_VALUE* value )
+{
+    RT_VALUE*   item;
+    FMAP_ITER   iter;
+    
+    value->gc = ( value->gc & GC_BUFFERED ) | GC_GARBAGE;
+    gc_push( gc , value );
+    
+    while ( ( value = gc_pop( gc ) ) != NULL )
+    {
+        gc_append( &gc->garbage , &gc->garbage_count , &gc->garbage_size , value );
+        fmap_iter_init( value->data , &iter );
+        
+        while ( ( item = gc_next_table( value->data , &iter ) ) != NULL )
+        {
+            if ( GC_COLOR( item ) == GC_GRAY )
+            {
+                item->gc = ( item->gc & GC_BUFFERED ) | GC_GARBAGE;
+                gc_push( gc , item );
+            }
+        }
+    }
+}
+
+/*
+decide every member at once, nothing runs in between so the held ones can
+not have picked up anything new, returns the tables freed
+*/
+static SLINT gc_finish( RUNTIME* runtime )
+{
+    GC_STATE*   gc = runtime->gc;
+    RT_VALUE*   value;
+    SLINT       count = gc->member_count;
+    SLINT       found;
+    SLINT       i;
+    
+    gc->phase = GC_IDLE;
+    gc->member_count = 0;
+    
+    /* what is left gray afterwards was only held from inside */
+    for ( i = 0; i < count; i++ )
+    {
+        value = gc->member[i].value;
+        
+        if ( value->gc & GC_DEAD )
+        {
+            if ( value->gc & GC_BUFFERED )
+            {
+                value->gc = GC_BUFFERED | GC_DEAD;
+            }
+            else
+            {
+                dealloc_value( runtime , value );
+            }
+            
+            gc->member[i].value = NULL;
+        }
+        else if ( value->gc & GC_HELD )
+        {
+            /* a count that dropped meanwhile may have left a new cycle */
+            if ( value->gc & GC_TOUCHED )
+            {
+                value->gc &= GC_BUFFERED;
+                gc_possible_root( runtime , value );
+            }
+            else
+            {
+                value->gc &= GC_BUFFERED;
+            }
+        }
+    }
+    
+    for ( i = 0; i < count; i++ )
+    {
+        value = gc->member[i].value;
+        
+        if ( ( value == NULL ) || ( GC_COLOR( value ) != GC_GRAY ) )
+        {
+            continue;
+        }
+        
+        if ( i < gc->member_roots )
+        {
+            gc->cycles++;
+        }
+        
+        gc_take_group( gc , value );
+    }
+    
+    gc->member_roots = 0;
+    
+    if ( gc->garbage_count > 0 )
+    {
+        found = gc->garbage_count;
+        gc_free_garbage( runtime );
+        return found;
+    }
+    
+    return 0;
+}
+
+/*
+go on with the pass, or start one from the buffer, until about budget
+tables were taken in or walked, 0 runs passes until the buffer is empty
+*/
+SLINT gc_collect( RUNTIME* runtime , SLINT budget )
+{
+    GC_STATE*   gc = runtime->gc;
+    SLINT       spent = 0;
+    SLINT       freed = 0;
+    
+    if ( gc == NULL )
+    {
+        return 0;
+    }
+    
+    do
+    {
+        if ( gc->phase == GC_IDLE )
+        {
+            gc_begin( runtime , budget , &spent );
+        }
+        
+        if ( gc->phase == GC_MARK )
+        {
+            gc_mark( gc , budget , &spent );
+        }
+        
+        if ( gc->phase == GC_SCAN )
+        {
+            gc_scan( gc , budget , &spent );
+        }
+        
+        if ( gc->phase == GC_DONE )
+        {
+            freed += gc_finish( runtime );
+        }
+    }
+    while ( ( budget <= 0 ) && ( gc->root_count > 0 ) );
+    
+    return freed;
+}
+
+void gc_possible_root( RUNTIME* runtime , RT_VALUE* value )
+{
+    GC_STATE*   gc = runtime->gc;
+    
+    if ( gc == NULL )
+    {
+        gc_set_color( value , GC_PURPLE );
+        return;
+    }
+    
+    if ( GC_COLOR( value ) == GC_GRAY )
+    {
+        gc_touch( gc , value );
+        return;
+    }
+    
+    gc_set_color( value , GC_PURPLE );
+    
+    if ( value->gc & GC_BUFFERED )
+    {
+        return;
+    }
+    
+    /* the taken ones are dropped from the front once the end is reached */
+    if ( ( gc->root_head > 0 ) && ( gc->root_count >= gc->root_size ) )
+    {
+        gc->root_count -= gc->root_head;
+        memmove( gc->root , gc->root + gc->root_head , sizeof( RT_VALUE* ) * gc->root_count );
+        gc->root_head = 0;
+    }
+    
+    value->gc |= GC_BUFFERED;
+    gc_append( &gc->root , &gc->root_count , &gc->root_size , value );
+}
+
+/* a candidate used again is in use, it is skipped when taken */
+void gc_ref( RUNTIME* runtime , RT_VALUE* value )
+{
+    if ( GC_COLOR( value ) == GC_PURPLE )
+    {
+        gc_set_color( value , GC_BLACK );
+    }
+    else if ( ( GC_COLOR( value ) == GC_GRAY ) && ( runtime->gc != NULL ) )
+    {
+        gc_touch( runtime->gc , value );
+    }
+}
+
+static int gc_hold_item( char* key , RT_VALUE* item , GC_STATE* gc )
+{
+    if ( ( item != NULL )
+        && ( item->type == RVT_TABLE )
+        && ( GC_COLOR( item ) == GC_GRAY ) )
+    {
+        gc_touch( gc , item );
+    }
+    
+    return 1;
+}
+
+/*
+a table freed while buffered or a member keeps its shell for the collector,
+a member's items may still be counted as inner refs while its map waits on
+the drop queue, so they are held
+*/
+SLINT gc_keep_shell( RUNTIME* runtime , RT_VALUE* value )
+{
+    GC_STATE*   gc = runtime->gc;
+    
+    if ( ( gc != NULL ) && ( GC_COLOR( value ) == GC_GRAY ) )
+    {
+        if ( gc->walking == value )
+        {
+            fmap_iter_end( value->data , &gc->iter );
+            gc->walking = NULL;
+        }
+        
+        fmap_foreach( value->data , ( FMAP_CALLBACK )gc_hold_item , gc );
+        value->gc |= GC_DEAD;
+        value->type = RVT_NULL;
+        value->data = NULL;
+        return 1;
+    }
+    
+    if ( ! ( value->gc & GC_BUFFERED ) )
+    {
+        return 0;
+    }
+    
+    value->gc = GC_BUFFERED | GC_DEAD;
+    value->type = RVT_NULL;
+    value->data = NULL;
+    return 1;
+}
+
+void gc_step( RUNTIME* runtime )
+{
+    GC_STATE*   gc = runtime->gc;
+    
+    if ( gc == NULL )
+    {
+        return;
+    }
+    
+    /* a pass only starts on a full buffer, then goes on at every call */
+    if ( ( gc->phase != GC_IDLE )
+        || ( gc->root_count - gc->root_head >= GC_ROOT_THRESHOLD ) )
+    {
+        gc_collect( runtime , GC_STEP_BUDGET );
+    }
+}
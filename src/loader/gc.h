@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#ifndef __LOADER_GC_H_INCLUDED__
+#define __LOADER_GC_H_INCLUDED__
+
+#include "slang.h"
+
+/* tables released with refs left are kept as candidates for a cycle check */
+#define GC_ROOT_THRESHOLD       256
+
+/* tables one call boundary may take in or walk once a pass is under way */
+#define GC_STEP_BUDGET          4096
+
+/* RT_VALUE.gc, the low bits hold the colour */
+#define GC_BLACK                0   /* in use or not looked at */
+#define GC_GRAY                 1   /* a member of the running pass */
+#define GC_PURPLE               3   /* released to a count above 0 */
+#define GC_COLOR_MASK           3
+#define GC_BUFFERED             4   /* in the root buffer */
+#define GC_DEAD                 8   /* freed while buffered or a member */
+#define GC_GARBAGE              16  /* part of the group being freed */
+#define GC_PINNED               32  /* the runtime holds one ref for good */
+#define GC_HELD                 64  /* a member reachable from outside */
+#define GC_TOUCHED              128 /* a member whose count changed meanwhile */
+#define GC_INDEX_SHIFT          8   /* a member's place in GC_STATE.member */
+
+#define GC_IDLE                 0
+#define GC_MARK                 1   /* walking members, counting inner refs */
+#define GC_SCAN                 2   /* spreading GC_HELD from held members */
+#define GC_DONE                 3
+
+typedef struct _GC_MEMBER       GC_MEMBER;
+
+struct _GC_MEMBER
+{
+    RT_VALUE*   value;
+    SLINT       count;      /* refs when taken in less those from members */
+};
+
+typedef struct _GC_STATE        GC_STATE;
+
+struct _GC_STATE
+{
+    RT_VALUE**  root;       /* candidates, taken oldest first */
+    SLINT       root_head;
+    SLINT       root_count;
+    SLINT       root_size;
+    GC_MEMBER*  member;     /* tables of the running pass */
+    SLINT       member_count;
+    SLINT       member_size;
+    SLINT       member_roots;   /* the first ones came from the buffer */
+    SLINT       phase;
+    SLINT       next;       /* next member to walk or to check */
+    RT_VALUE*   walking;    /* member whose items iter is going through */
+    FMAP_ITER   iter;
+    RT_VALUE**  work;       /* held members still to walk */
+    SLINT       work_count;
+    SLINT       work_size;
+    RT_VALUE**  garbage;
+    SLINT       garbage_count;
+    SLINT       garbage_size;
+    UINT64      cycles;     /* garbage groups found */
+    UINT64      tables;     /* tables freed by the collector */
+    UINT64      bytes;      /* memory those gave back */
+};
+
+GC_STATE* new_gc_state();
+
+void free_gc_state( GC_STATE* gc );
+
+#endif
@@ -112,7 +112,7 @@ int get_param_form_commandline(
     for ( i = 0; i < count; i++ )
     {
         snprintf( name , 16 , "%d" , i + 1 );
-        dmap_insert(
+        fmap_insert(
             item[0].value->data     ,
             name                    ,
             ref_value_str(
@@ -129,6 +129,22 @@ int get_param_form_commandline(
     return count;
 }
 
+/* SLANG_MEM_SOFT and SLANG_MEM_HARD give the limits in bytes */
+void get_memlimit_form_env( RUNTIME* runtime )
+{
+    char*   soft;
+    char*   hard;
+    
+    soft = getenv( "SLANG_MEM_SOFT" );
+    hard = getenv( "SLANG_MEM_HARD" );
+    
+    runtime_set_memlimit(
+        runtime ,
+        soft ? strtoll( soft , NULL , 10 ) : 0 ,
+        hard ? strtoll( hard , NULL , 10 ) : 0
+    );
+}
+
 int loader( char* src_file , int argc , char** argv )
 {
     char        cur_path[MAX_PATH];
@@ -150,6 +166,8 @@ int loader( char* src_file , int argc , char** argv )
         return 1;
     }
     
+    get_memlimit_form_env( runtime );
+    
     module_name[0] = '.';
     getfilename( src_file , &( module_name[1] ) );
     
@@ -196,6 +214,7 @@ int loader( char* src_file , int argc , char** argv )
     }
     
     release_runtime( runtime );
+    free_names();
     
     return 0;
 }
@@ -273,6 +292,7 @@ int main( int argc , char** argv )
         
         dump_node( node , dest_file );
         free_node( node );
+        free_names();
     }
     else if ( mode == 2 )
     {
@@ -13,6 +13,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  * */
 
+#define MEMALLOC_CATEGORY   MEMCAT_VALUE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -22,14 +24,113 @@
 #include "datadump.h"
 #include "mem.h"
 
+RT_VALUE* alloc_value( RUNTIME* runtime )
+{
+    return mempool_alloc_zero( runtime->pool , sizeof( RT_VALUE ) );
+}
+
+void dealloc_value( RUNTIME* runtime , RT_VALUE* value )
+{
+    if ( VALUE_IS_INLINE( value ) )
+    {
+        mempool_free(
+            runtime->pool ,
+            value ,
+            sizeof( RT_VALUE ) + VALUE_INLINE_MAX + 1
+        );
+        return;
+    }
+    
+    mempool_free( runtime->pool , value , sizeof( RT_VALUE ) );
+}
+
+/* a value with room for size bytes of text and the zero after them */
+static RT_VALUE* alloc_str_value( RUNTIME* runtime , int size )
+{
+    RT_VALUE*   ret;
+    
+    if ( size > VALUE_INLINE_MAX )
+    {
+        ret = alloc_value( runtime );
+        ret->data = memalloc_zero( size + 1 );
+        return ret;
+    }
+    
+    ret = mempool_alloc_zero(
+        runtime->pool ,
+        sizeof( RT_VALUE ) + VALUE_INLINE_MAX + 1
+    );
+    ret->data = ret + 1;
+    return ret;
+}
+
+RT_VALUE* new_int64_value( RUNTIME* runtime , INT64 value )
+{
+    RT_VALUE*   ret;
+    
+    ret = alloc_value( runtime );
+    ret->num.i = value;
+    ret->type = RVT_INT64;
+    ret->ref = 1;
+    runtime->total_ref++;
+    return ret;
+}
+
 void mem_init( RUNTIME* runtime )
 {
     runtime->total_ref = 0;
+    runtime->gc = new_gc_state();
+    runtime->drop = new_drop_queue();
+    runtime->pool = memalloc( sizeof( MEM_POOL ) );
+    mempool_init( runtime->pool , MEMCAT_VALUE );
     runtime->hdelvalue = dlist_init();
+    runtime->frame = NULL;
+    runtime->frame_spare = NULL;
+    
+    /* compare results and flags share these instead of allocating */
+    runtime->bool_value[0] = new_int64_value( runtime , 0 );
+    runtime->bool_value[1] = new_int64_value( runtime , 1 );
+    runtime->bool_value[0]->gc |= GC_PINNED;
+    runtime->bool_value[1]->gc |= GC_PINNED;
+}
+
+void frame_release( RUNTIME* runtime )
+{
+    FRAME_CHUNK*    chunk;
+    
+    while ( runtime->frame )
+    {
+        chunk = runtime->frame;
+        runtime->frame = chunk->prev;
+        memfree( chunk );
+    }
+    
+    if ( runtime->frame_spare )
+    {
+        memfree( runtime->frame_spare );
+        runtime->frame_spare = NULL;
+    }
 }
 
 void mem_release( RUNTIME* runtime )
 {
+    /* whatever tables are left now are queued or only held by cycles */
+    do
+    {
+        drop_flush( runtime );
+    }
+    while ( gc_collect( runtime , 0 ) > 0 );
+    
+    free_drop_queue( runtime->drop );
+    runtime->drop = NULL;
+    free_gc_state( runtime->gc );
+    runtime->gc = NULL;
+    
+    unref_value( runtime , runtime->bool_value[0] );
+    unref_value( runtime , runtime->bool_value[1] );
+    runtime->bool_value[0] = NULL;
+    runtime->bool_value[1] = NULL;
+    
     if ( runtime->total_ref != 0 )
     {
         log_info( "ref = %d" , runtime->total_ref );
@@ -65,6 +166,13 @@ void mem_release( RUNTIME* runtime )
     
     dlist_release( runtime->hdelvalue );
     runtime->hdelvalue = NULL;
+    
+    frame_release( runtime );
+    
+    /* values still referenced at exit go with their slabs */
+    mempool_release( runtime->pool );
+    memfree( runtime->pool );
+    runtime->pool = NULL;
 }
 
 void mem_ext_ref( RUNTIME* runtime , int ref )
@@ -77,6 +185,77 @@ HDLIST get_delvalue( RUNTIME* runtime )
     return runtime->hdelvalue;
 }
 
+void* frame_push( RUNTIME* runtime , UINT size )
+{
+    FRAME_CHUNK*    chunk;
+    UINT            chunk_size;
+    void*           ret;
+    
+    if ( size == 0 )
+    {
+        return NULL;
+    }
+    
+    size = ( size + 7 ) & ~7;
+    chunk = runtime->frame;
+    
+    if ( ( chunk == NULL ) || ( chunk->top + size > chunk->size ) )
+    {
+        chunk = runtime->frame_spare;
+        runtime->frame_spare = NULL;
+        
+        if ( ( chunk != NULL ) && ( chunk->size < size ) )
+        {
+            memfree( chunk );
+            chunk = NULL;
+        }
+        
+        if ( chunk == NULL )
+        {
+            chunk_size = MAX( size , FRAME_CHUNK_SIZE );
+            chunk = memalloc( sizeof( FRAME_CHUNK ) + chunk_size );
+            chunk->size = chunk_size;
+        }
+        
+        chunk->top = 0;
+        chunk->prev = runtime->frame;
+        runtime->frame = chunk;
+    }
+    
+    ret = chunk->data + chunk->top;
+    chunk->top += size;
+    memset( ret , 0 , size );
+    return ret;
+}
+
+void frame_pop( RUNTIME* runtime , void* ptr )
+{
+    FRAME_CHUNK*    chunk;
+    
+    chunk = runtime->frame;
+    
+    if ( ( ptr == NULL ) || ( chunk == NULL ) )
+    {
+        return;
+    }
+    
+    chunk->top = ( char* )ptr - chunk->data;
+    
+    if ( ( chunk->top == 0 ) && ( chunk->prev != NULL ) )
+    {
+        /* keep one chunk back so a call loop at a chunk edge */
+        /* does not allocate every time */
+        runtime->frame = chunk->prev;
+        
+        if ( runtime->frame_spare )
+        {
+            memfree( runtime->frame_spare );
+        }
+        
+        runtime->frame_spare = chunk;
+    }
+}
+
 RT_VALUE* ref_value( RUNTIME* runtime , RT_VALUE* value )
 {
     if ( value )
@@ -93,33 +272,120 @@ RT_VALUE* ref_value( RUNTIME* runtime , RT_VALUE* value )
         
         value->ref++;
         runtime->total_ref++;
+        
+        /* only tables are ever coloured by the collector */
+        if ( value->gc & GC_COLOR_MASK )
+        {
+            gc_ref( runtime , value );
+        }
     }
     
     return value;
 }
 
 RT_VALUE* ref_value_int( RUNTIME* runtime , int value )
+{
+    return ref_value_int64( runtime , value );
+}
+
+/* scalars are never changed in place, so 0 and 1 can be shared */
+RT_VALUE* ref_value_int64( RUNTIME* runtime , INT64 value )
+{
+    if ( ( ( value == 0 ) || ( value == 1 ) )
+        && ( runtime->bool_value[ value ] != NULL ) )
+    {
+        return ref_value( runtime , runtime->bool_value[ value ] );
+    }
+    
+    return new_int64_value( runtime , value );
+}
+
+RT_VALUE* ref_value_double( RUNTIME* runtime , double value )
 {
     RT_VALUE*   ret;
     
-    ret = memalloc_zero( sizeof( RT_VALUE ) );
-    ret->data = memalloc_zero( 16 );
-    snprintf( ret->data , 16 , "%d" , value );
-    ret->size = strlen( ret->data );
-    ret->type = RVT_STRING;
+    ret = alloc_value( runtime );
+    ret->num.d = value;
+    ret->type = RVT_DOUBLE;
     ret->ref = 1;
     runtime->total_ref++;
     return ret;
 }
 
+/* shortest of %.15g and %.17g that reads back as the same double */
+SLINT format_double( char* buf , SLINT size , double value )
+{
+    snprintf( buf , size , "%.15g" , value );
+    
+    if ( strtod( buf , NULL ) != value )
+    {
+        snprintf( buf , size , "%.17g" , value );
+    }
+    
+    return strlen( buf );
+}
+
+/* a slice made into a C string has its own copy and no longer points in */
+static SLINT slice_owned( RT_VALUE* value )
+{
+    char*   text = value->num.parent->data;
+    
+    return ( ( char* )value->data < text )
+        || ( ( char* )value->data > text + value->num.parent->size );
+}
+
+char* value_cstr( RT_VALUE* value )
+{
+    char    buf[32];
+    char*   text;
+    
+    if ( value == NULL )
+    {
+        return NULL;
+    }
+    
+    /* one that ends where its parent ends is already terminated */
+    if ( ( value->type == RVT_SLICE )
+        && ( ( ( char* )value->data )[ value->size ] != 0 ) )
+    {
+        text = memalloc( value->size + 1 );
+        memcpy( text , value->data , value->size );
+        text[ value->size ] = 0;
+        value->data = text;
+    }
+    
+    if ( ( value->data == NULL )
+        && ( ( value->type == RVT_INT64 ) || ( value->type == RVT_DOUBLE ) ) )
+    {
+        if ( value->type == RVT_INT64 )
+        {
+            snprintf( buf , 32 , "%lld" , value->num.i );
+        }
+        else
+        {
+            format_double( buf , 32 , value->num.d );
+        }
+        
+        value->size = strlen( buf );
+        value->data = memalloc_zero( value->size + 1 );
+        memcpy( value->data , buf , value->size );
+    }
+    
+    if ( ! RVT_IS_SCALAR( value->type ) )
+    {
+        return NULL;
+    }
+    
+    return value->data;
+}
+
 RT_VALUE* ref_value_str( RUNTIME* runtime , char* str , int size , int bcopy )
 {
     RT_VALUE*   ret;
     
-    ret = memalloc_zero( sizeof( RT_VALUE ) );
-    
     if ( ( str == NULL ) || ( size == 0 ) )
     {
+        ret = alloc_value( runtime );
         ret->type = RVT_NULL;
         ret->size = 0;
         ret->data = NULL;
@@ -128,11 +394,12 @@ RT_VALUE* ref_value_str( RUNTIME* runtime , char* str , int size , int bcopy )
     {
         if ( bcopy )
         {
-            ret->data = memalloc_zero( size + 1 );
+            ret = alloc_str_value( runtime , size );
             memcpy( ret->data , str , size );
         }
         else
         {
+            ret = alloc_value( runtime );
             ret->data = str;
         }
         
@@ -145,28 +412,166 @@ RT_VALUE* ref_value_str( RUNTIME* runtime , char* str , int size , int bcopy )
     return ret;
 }
 
-int unref_table_callback( char* name , void* data , RUNTIME* runtime )
-{
-    if ( data != NULL )
+RT_VALUE* ref_value_slice(
+    RUNTIME*    runtime ,
+    RT_VALUE*   parent  ,
+    char*       str     ,
+    int         size
+) {
+    RT_VALUE*   ret;
+    
+    /* a slice of a slice shares the text of the first parent */
+    if ( ( parent != NULL )
+        && ( parent->type == RVT_SLICE )
+        && ! slice_owned( parent ) )
     {
-        unref_value( runtime , data );
+        parent = parent->num.parent;
     }
     
-    return 1;
+    if ( ( parent == NULL )
+        || ( parent->type == RVT_SLICE )
+        || ( ! RVT_IS_SCALAR( parent->type ) )
+        || ( parent->data == NULL )
+        || ( size <= VALUE_INLINE_MAX )
+        || ( ( INT64 )size * SLICE_SHARE < parent->size )
+        || ( str < ( char* )parent->data )
+        || ( str + size > ( char* )parent->data + parent->size ) )
+    {
+        return ref_value_str( runtime , str , size , 1 );
+    }
+    
+    ret = alloc_value( runtime );
+    ret->type = RVT_SLICE;
+    ret->data = str;
+    ret->size = size;
+    ret->num.parent = ref_value( runtime , parent );
+    ret->ref = 1;
+    runtime->total_ref++;
+    return ret;
 }
 
 RT_VALUE* new_table_value( RUNTIME* runtime )
 {
     RT_VALUE*   ret;
     
-    ret = memalloc_zero( sizeof( RT_VALUE ) );
+    ret = alloc_value( runtime );
     ret->type = RVT_TABLE;
-    ret->data = dmap_init( 3 );
+    ret->data = fmap_init( 0 );
     ret->ref = 1;
     runtime->total_ref++;
     return ret;
 }
 
+/*
+replace remove bytes at pos with size bytes of str, only a heap string no
+one else holds can change, its buffer at least doubles when it grows so
+building a string one piece at a time stays linear
+*/
+SLINT value_str_splice(
+    RUNTIME*    runtime ,
+    RT_VALUE*   value   ,
+    SLINT       pos     ,
+    SLINT       remove  ,
+    char*       str     ,
+    SLINT       size
+) {
+    char*   data;
+    INT64   capacity;
+    INT64   length;
+    
+    if ( ( value == NULL )
+        || ( value->type != RVT_STRING )
+        || ( value->ref != 1 )
+        || ( value->data == NULL )
+        || VALUE_IS_INLINE( value ) )
+    {
+        return 0;
+    }
+    
+    data = value->data;
+    
+    /* the piece may come from the buffer that is about to move */
+    if ( ( str >= data ) && ( str <= data + value->size ) )
+    {
+        return 0;
+    }
+    
+    length = ( INT64 )value->size - remove + size;
+    capacity = value->num.capacity;
+    
+    if ( capacity <= value->size )
+    {
+        capacity = ( INT64 )value->size + 1;
+    }
+    
+    if ( length + 1 > capacity )
+    {
+        capacity = MAX( capacity * 2 , length + 1 );
+        data = memalloc( capacity );
+        memcpy( data , value->data , value->size );
+        memfree( value->data );
+        value->data = data;
+        value->num.capacity = capacity;
+    }
+    
+    memmove(
+        data + pos + size ,
+        data + pos + remove ,
+        value->size - pos - remove
+    );
+    memcpy( data + pos , str , size );
+    data[length] = 0;
+    value->size = length;
+    update_value( runtime , value );
+    return 1;
+}
+
+/*
+a constant operand makes its value on the first run and holds it until
+its module is released, values are never changed in place, so a
+statement can hand it out instead of copying the literal each time
+*/
+RT_VALUE* ref_value_const( RUNTIME* runtime , CODE_VALUE* cvalue )
+{
+    RT_VALUE*   value;
+    
+    if ( cvalue->data == NULL )
+    {
+        return ref_value_str( runtime , NULL , 0 , 1 );
+    }
+    
+    value = cvalue->shared;
+    
+    if ( value == NULL )
+    {
+        value = ref_value_str(
+            runtime ,
+            cvalue->data ,
+            strlen( cvalue->data ) ,
+            1
+        );
+        value->gc |= GC_PINNED;
+        cvalue->shared = value;
+    }
+    
+    return ref_value( runtime , value );
+}
+
+void unref_value_const( RUNTIME* runtime , CODE_VALUE* cvalue )
+{
+    RT_VALUE*   value = cvalue->shared;
+    
+    if ( value == NULL )
+    {
+        return;
+    }
+    
+    /* a variable may keep it, then it is stored like any other value */
+    value->gc &= ~GC_PINNED;
+    cvalue->shared = NULL;
+    unref_value( runtime , value );
+}
+
 void update_value( RUNTIME* runtime , RT_VALUE* value )
 {
     if ( value )
@@ -183,12 +588,15 @@ void update_value( RUNTIME* runtime , RT_VALUE* value )
 
 void unref_value( RUNTIME* runtime , RT_VALUE* value )
 {
+    HFMAP   map;
+    SLINT   keep;
+    
     if ( value != NULL )
     {
         if ( value->type == RVT_TBL_ITEM_UNLOAD )
         {
             map_int_query( runtime->loadvar , 0 );
-            memfree( value );
+            dealloc_value( runtime , value );
         }
         else if ( value->ref > 0 )
         {
@@ -203,20 +611,38 @@ void unref_value( RUNTIME* runtime , RT_VALUE* value )
                     dlist_push( runtime->hdelvalue , value->fpos );
                 }
 #endif
-                if ( value->type == RVT_STRING )
+                if ( value->type == RVT_SLICE )
+                {
+                    if ( slice_owned( value ) )
+                    {
+                        memfree( value->data );
+                    }
+                    
+                    unref_value( runtime , value->num.parent );
+                }
+                else if ( RVT_IS_SCALAR( value->type )
+                    && ! VALUE_IS_INLINE( value ) )
                 {
                     memfree( value->data );
                 }
                 else if ( value->type == RVT_TABLE )
                 {
-                    dmap_release(
-                        value->data ,
-                        ( DMAP_CALLBACK )unref_table_callback ,
-                        runtime
-                    );
+                    /* the collector looks at the items before they go */
+                    map = value->data;
+                    keep = gc_keep_shell( runtime , value );
+                    drop_table( runtime , map );
+                    
+                    if ( keep )
+                    {
+                        return;
+                    }
                 }
                 
-                memfree( value );
+                dealloc_value( runtime , value );
+            }
+            else if ( value->type == RVT_TABLE )
+            {
+                gc_possible_root( runtime , value );
             }
         }
     }
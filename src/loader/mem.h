@@ -28,16 +28,95 @@ void mem_ext_ref( RUNTIME* runtime , int ref );
 
 HDLIST get_delvalue( RUNTIME* runtime );
 
+void* frame_push( RUNTIME* runtime , UINT size );
+
+void frame_pop( RUNTIME* runtime , void* ptr );
+
+/*
+a string this short is kept in the same pool block right after its value,
+the block fills a 64 byte class, data still points at the text
+*/
+#define VALUE_INLINE_MAX        22
+
+#define VALUE_IS_INLINE( value )                                        \
+    ( ( void* )( value )->data == ( void* )( ( value ) + 1 ) )
+
+/*
+a slice shares its parent's text when it is longer than an inline string
+and at least 1 / SLICE_SHARE of the parent, so it never keeps alive much
+more than itself, anything smaller is copied
+*/
+#define SLICE_SHARE             4
+
+/* zeroed value from the runtime pool, ref is left 0 */
+RT_VALUE* alloc_value( RUNTIME* runtime );
+
+void dealloc_value( RUNTIME* runtime , RT_VALUE* value );
+
 RT_VALUE* ref_value( RUNTIME* runtime , RT_VALUE* value );
 
 RT_VALUE* ref_value_int( RUNTIME* runtime , int value );
 
+RT_VALUE* ref_value_int64( RUNTIME* runtime , INT64 value );
+
+RT_VALUE* ref_value_double( RUNTIME* runtime , double value );
+
+SLINT format_double( char* buf , SLINT size , double value );
+
+/* text of a string or number value, numbers are formatted on first read */
+char* value_cstr( RT_VALUE* value );
+
 RT_VALUE* ref_value_str( RUNTIME* runtime , char* str , int size , int bcopy );
 
 RT_VALUE* new_table_value( RUNTIME* runtime );
 
+/* size bytes at str, which lies in the text of parent */
+RT_VALUE* ref_value_slice(
+    RUNTIME*    runtime ,
+    RT_VALUE*   parent  ,
+    char*       str     ,
+    int         size
+);
+
+/* change an unshared string in place, 0 when it has to be copied */
+SLINT value_str_splice(
+    RUNTIME*    runtime ,
+    RT_VALUE*   value   ,
+    SLINT       pos     ,
+    SLINT       remove  ,
+    char*       str     ,
+    SLINT       size
+);
+
+/* a reference to the one shared value of a constant operand */
+RT_VALUE* ref_value_const( RUNTIME* runtime , CODE_VALUE* cvalue );
+
+/* drop the operand's hold on its shared value, when its code goes */
+void unref_value_const( RUNTIME* runtime , CODE_VALUE* cvalue );
+
 void update_value( RUNTIME* runtime , RT_VALUE* value );
 
 void unref_value( RUNTIME* runtime , RT_VALUE* v );
 
+/* cycle collector, budget is tables to take in or walk, 0 runs to the end */
+SLINT gc_collect( RUNTIME* runtime , SLINT budget );
+
+void gc_possible_root( RUNTIME* runtime , RT_VALUE* value );
+
+/* a table with a colour was referenced again */
+void gc_ref( RUNTIME* runtime , RT_VALUE* value );
+
+SLINT gc_keep_shell( RUNTIME* runtime , RT_VALUE* value );
+
+/* called at each node call, works through the buffer once it is full */
+void gc_step( RUNTIME* runtime );
+
+/* frees the items of a released table now or through the drop queue */
+void drop_table( RUNTIME* runtime , HFMAP map );
+
+/* called at each node call, frees a slice of the queued items */
+void drop_step( RUNTIME* runtime );
+
+void drop_flush( RUNTIME* runtime );
+
 #endif
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#define MEMALLOC_CATEGORY   MEMCAT_CODE
+
+#include <string.h>
+
+#include "memalloc.h"
+#include "map_flat.h"
+#include "slang.h"
+
+/*
+node , param and module names are kept once for the whole process, a node
+or a param list only holds a pointer, so equal names share one copy and a
+PARAM_ITEM stays two pointers wide
+*/
+static HFMAP    names = NULL;
+
+char* intern_name( const char* name , int len )
+{
+    char    key[MAX_NAME_LEN];
+    char*   ret;
+    
+    if ( len < 0 )
+    {
+        len = strlen( name );
+    }
+    
+    if ( len > MAX_NAME_LEN - 1 )
+    {
+        len = MAX_NAME_LEN - 1;
+    }
+    
+    memcpy( key , name , len );
+    key[len] = 0;
+    
+    if ( names == NULL )
+    {
+        names = fmap_init( 64 );
+    }
+    
+    ret = fmap_query( names , key );
+    
+    if ( ret == NULL )
+    {
+        ret = memalloc( len + 1 );
+        memcpy( ret , key , len + 1 );
+        fmap_insert( names , key , ret );
+    }
+    
+    return ret;
+}
+
+static int free_name_callback( char* key , void* data , void* param )
+{
+    memfree( data );
+    return 1;
+}
+
+void free_names()
+{
+    if ( names != NULL )
+    {
+        fmap_release( names , free_name_callback , NULL );
+        names = NULL;
+    }
+}
@@ -23,10 +23,13 @@
 #include "eval.h"
 #include "sysnode.h"
 #include "text_conv.h"
+#include "strscan.h"
 #include "slextlib.h"
+#include "bytecode.h"
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 #ifdef WINDOWS
     #include <windows.h>
@@ -39,15 +42,25 @@
 RUNTIME* new_runtime( char* basepath )
 {
     RUNTIME*    ret;
+    MEM_STATS*  mem;
+    MEM_STATS*  oldcharge;
     int         charset;
     
     charset = CL_UTF8;
+    
+    /* everything until it returns is charged to the new runtime */
+    mem = memalloc_zero( sizeof( MEM_STATS ) );
+    oldcharge = memstats_charge( mem );
     ret = memalloc_zero( sizeof( RUNTIME ) );
+    ret->mem = mem;
     mem_init( ret );
     
     ret->root = NULL;
     ret->module = dmap_init( 10000 );
     ret->sysnode = init_sysnode_map();
+    ret->node_generation = 1;
+    ret->eval_cache = new_eval_cache( EVAL_CACHE_SIZE );
+    ret->eval_cache_generation = ret->node_generation;
     strncpy(
         ret->basepath ,
         basepath ,
@@ -75,12 +88,64 @@ RUNTIME* new_runtime( char* basepath )
     if ( dmp_init( ret ) == 0 )
     {
         release_runtime( ret );
+        memstats_charge( oldcharge );
         return NULL;
     }
     
+    memstats_charge( oldcharge );
     return ret;
 }
 
+void runtime_set_memlimit( RUNTIME* runtime , INT64 soft , INT64 hard )
+{
+    runtime->mem_soft_limit = soft;
+    runtime->mem_hard_limit = hard;
+    runtime->mem_soft_warned = 0;
+}
+
+/* 0 when the call has to be refused for memory */
+SLINT check_memlimit( RUNTIME* runtime , bchar* mod_node_name )
+{
+    INT64   live;
+    
+    if ( ( runtime->mem_soft_limit <= 0 ) && ( runtime->mem_hard_limit <= 0 ) )
+    {
+        return 1;
+    }
+    
+    live = runtime->mem->live;
+    
+    if ( ( runtime->mem_hard_limit > 0 ) && ( live > runtime->mem_hard_limit ) )
+    {
+        log_error(
+            "call '%s' refused, %lld bytes in use over the limit %lld" ,
+            mod_node_name ,
+            live ,
+            runtime->mem_hard_limit
+        );
+        return 0;
+    }
+    
+    if ( ( runtime->mem_soft_limit > 0 ) && ( live > runtime->mem_soft_limit ) )
+    {
+        if ( ! runtime->mem_soft_warned )
+        {
+            log_info(
+                "%lld bytes in use over the soft limit %lld" ,
+                live ,
+                runtime->mem_soft_limit
+            );
+            runtime->mem_soft_warned = 1;
+        }
+    }
+    else
+    {
+        runtime->mem_soft_warned = 0;
+    }
+    
+    return 1;
+}
+
 SLINT release_module( RUNTIME* runtime , MODULE* module )
 {
     if ( module == NULL )
@@ -125,18 +190,34 @@ SLINT release_runtime_callback(
 
 SLINT release_runtime( RUNTIME* runtime )
 {
-    dmp_release( runtime );
+    MEM_STATS*  oldcharge;
+    
+    if ( runtime == NULL )
+    {
+        return 0;
+    }
+    
+    oldcharge = memstats_charge( runtime->mem );
     
-    if ( runtime != NULL )
+    /* its own stats are freed below, nothing may be charged to them */
+    if ( oldcharge == runtime->mem )
     {
-        dmap_release( runtime->module , release_runtime_callback , runtime );
-        dmap_release( runtime->sysnode , NULL , NULL );
+        oldcharge = NULL;
     }
     
+    dmp_release( runtime );
+    dmap_release( runtime->module , release_runtime_callback , runtime );
+    dmap_release( runtime->sysnode , NULL , NULL );
+    
     memfree( runtime->src_ext_filename );
     memfree( runtime->bin_ext_filename );
+    free_eval_cache( runtime->eval_cache );
     
     mem_release( runtime );
+    
+    memstats_charge( oldcharge );
+    memfree( runtime->mem );
+    runtime->mem = NULL;
     return 1;
 }
 
@@ -223,12 +304,7 @@ int load_module_form_file(
         }
     }
     
-    tmp_str = dup_str( full_name );
-    strncpy(
-        module->name ,
-        tmp_str ,
-        MIN( strlen( tmp_str ) , MAX_NAME_LEN - 1 )
-    );
+    module->name = intern_name( full_name , -1 );
     return 1;
 }
 
@@ -263,7 +339,7 @@ void set_node_map( MODULE* module )
     }
 }
 
-MODULE* load_module( RUNTIME* runtime , bchar* name )
+static MODULE* load_module_file( RUNTIME* runtime , bchar* name )
 {
     bchar       full_name[MAX_NAME_LEN];
     MODULE*     module = NULL;
@@ -298,6 +374,22 @@ MODULE* load_module( RUNTIME* runtime , bchar* name )
     release_module( runtime , dmap_getanddel( runtime->module , full_name ) );
     set_node_map( module );
     dmap_insert( runtime->module , full_name , module );
+    runtime->node_generation++;
+    return module;
+}
+
+/*
+the host may load outside any call, the module and the old one it replaces,
+whose code grew while it ran, are charged to the runtime all the same
+*/
+MODULE* load_module( RUNTIME* runtime , bchar* name )
+{
+    MODULE*     module;
+    MEM_STATS*  oldcharge;
+    
+    oldcharge = memstats_charge( runtime->mem );
+    module = load_module_file( runtime , name );
+    memstats_charge( oldcharge );
     return module;
 }
 
@@ -318,11 +410,7 @@ MODULE* load_module_from_node(
     }
     
     module = memalloc_zero( sizeof( MODULE ) );
-    strncpy(
-        module->name ,
-        full_name ,
-        MIN( strlen( full_name ) , MAX_NAME_LEN - 1 )
-    );
+    module->name = intern_name( full_name , -1 );
     module->node = node;
     
     if ( module->node == NULL )
@@ -333,6 +421,7 @@ MODULE* load_module_from_node(
     
     set_node_map( module );
     dmap_insert( runtime->module , full_name , module );
+    runtime->node_generation++;
     return module;
 }
 
@@ -362,26 +451,20 @@ SLINT copy_node_param( NODE_PARAM* param_dest , NODE_PARAM* param_temp )
     return 1;
 }
 
-SLINT run_code( RUNTIME* runtime , CODE* code , SLINT* errorno );
+SLINT run_bytecode( RUNTIME* runtime , BYTECODE* bytecode , SLINT* errorno );
 
-SLINT call_user_node(
+SLINT find_user_node(
     RUNTIME*    runtime             ,
     bchar*      mod_node_name       ,
-    PARAM_ITEM* paramvalue          ,
-    SLINT       paramvalue_count    ,
-    PARAM_ITEM* retvalue            ,
-    SLINT       retvalue_count      ,
+    MODULE**    pmodule             ,
+    NODE**      pnode               ,
     SLINT*      errorno
 ) {
-    SLINT       ret;
     bchar*      node_name;
     bchar       module_name[MAX_NAME_LEN * 2];
     MODULE*     module;
     NODE*       node;
-    RT_VALUE*   dmpval;
-    SLINT       i;
     bchar       full_name[MAX_NAME_LEN];
-    NODE_PARAM  node_param;
     
     if ( strlen( mod_node_name ) >= MAX_NAME_LEN * 2 )
     {
@@ -467,6 +550,27 @@ SLINT call_user_node(
         return RET_NO_NODE;
     }
     
+    *pmodule = module;
+    *pnode = node;
+    return RET_OK;
+}
+
+SLINT invoke_user_node(
+    RUNTIME*    runtime             ,
+    bchar*      mod_node_name       ,
+    MODULE*     module              ,
+    NODE*       node                ,
+    PARAM_ITEM* paramvalue          ,
+    SLINT       paramvalue_count    ,
+    PARAM_ITEM* retvalue            ,
+    SLINT       retvalue_count      ,
+    SLINT*      errorno
+) {
+    SLINT       ret;
+    RT_VALUE*   dmpval;
+    SLINT       i;
+    NODE_PARAM  node_param;
+    
     memcpy( &runtime->caller , &runtime->current , sizeof( CALLCONTEXT ) );
     
     if ( ( node->type == NT_EXTNODE ) && ( node->extfunc != NULL ) )
@@ -497,6 +601,18 @@ SLINT call_user_node(
         return RET_ERROR;
     }
     
+    if ( node->body->bytecode == NULL )
+    {
+        node->body->bytecode = compile_bytecode( node->body->code );
+        
+        if ( node->body->bytecode == NULL )
+        {
+            *errorno = __LINE__;
+            log_error( "compile %s error" , mod_node_name );
+            return RET_ERROR;
+        }
+    }
+    
     if ( ( node->param != NULL )
         && ( node->param->count > 0 ) )
     {
@@ -521,15 +637,29 @@ SLINT call_user_node(
             
             node->status = NS_LOADDATA;
         }
+    }
+    
+    memset( &node_param , 0 , sizeof( NODE_PARAM ) );
+    
+    if ( node->param != NULL )
+    {
+        memcpy( &node_param , node->param , sizeof( NODE_PARAM ) );
+        node_param.frame = NULL;
         
-        if ( node->param->count1 > 0 )
+        if ( node_param.count1 > 0 )
         {
-            for ( i = 0; i < node->param->count1; i++ )
+            /* locals live on the frame stack, so every activation */
+            /* gets its own set */
+            node_param.frame = frame_push(
+                runtime ,
+                sizeof( RT_VALUE* ) * node_param.count1
+            );
+            
+            for ( i = 0; i < node_param.count1; i++ )
             {
                 if ( i < paramvalue_count )
                 {
-                    unref_value( runtime , node->param->list[i].value );
-                    node->param->list[i].value = ref_value(
+                    node_param.frame[i] = ref_value(
                         runtime ,
                         paramvalue[i].value
                     );
@@ -540,16 +670,20 @@ SLINT call_user_node(
     
     runtime->current.module = module;
     runtime->current.node = node;
-    runtime->current.param = node->param;
+    runtime->current.param = &node_param;
     runtime->current.retvalue = retvalue;
     runtime->current.retvalue_count = retvalue_count;
     
-    ret = run_code( runtime , node->body->code , errorno );
+    ret = run_bytecode( runtime , node->body->bytecode , errorno );
     
-    for ( i = 0; i < node->param->count1; i++ )
+    if ( node_param.frame != NULL )
     {
-        unref_value( runtime , node->param->list[i].value );
-        node->param->list[i].value = NULL;
+        for ( i = 0; i < node_param.count1; i++ )
+        {
+            unref_value( runtime , node_param.frame[i] );
+        }
+        
+        frame_pop( runtime , node_param.frame );
     }
     
     if ( ( node->param != NULL ) && ( node->param->count > 0 ) )
@@ -575,8 +709,9 @@ SLINT call_user_node(
     return ret;
 }
 
-SLINT call_node(
+SLINT call_node_cached(
     RUNTIME*        runtime             ,
+    CALL_CACHE*     cache               ,
     bchar*          mod_node_name       ,
     PARAM_ITEM*     paramvalue          ,
     SLINT           paramvalue_count    ,
@@ -585,25 +720,91 @@ SLINT call_node(
     SLINT*          errorno
 ) {
     SLINT       ret;
-    SLINT       i;
+    MODULE*     module;
+    NODE*       node;
+    EXTFUNC     sysfunc;
     CALLCONTEXT oldcontext;
     CALLCONTEXT oldcallercontext;
     NODE_PARAM  node_param;
+    MEM_STATS*  oldcharge;
+    
+    /* a call may come from the host or another runtime, */
+    /* which gets its own charge back when the call returns */
+    oldcharge = memstats_charge( runtime->mem );
+    
+    if ( ! check_memlimit( runtime , mod_node_name ) )
+    {
+        memstats_charge( oldcharge );
+        *errorno = __LINE__;
+        return RET_ERROR;
+    }
+    
+    gc_step( runtime );
+    drop_step( runtime );
     
     memcpy( &oldcontext , &runtime->current , sizeof( CALLCONTEXT ) );
     memcpy( &oldcallercontext , &runtime->caller , sizeof( CALLCONTEXT ) );
     
-    ret = call_user_node(
-        runtime             ,
-        mod_node_name       ,
-        paramvalue          ,
-        paramvalue_count    ,
-        retvalue            ,
-        retvalue_count      ,
-        errorno
-    );
+    module = NULL;
+    node = NULL;
+    sysfunc = NULL;
     
-    if ( ret == RET_NO_NODE )
+    if ( ( cache != NULL )
+        && ( cache->generation == runtime->node_generation )
+        && ( cache->caller == runtime->current.module ) )
+    {
+        module = cache->module;
+        node = cache->node;
+        sysfunc = cache->sysfunc;
+        ret = RET_OK;
+    }
+    else
+    {
+        ret = find_user_node(
+            runtime         ,
+            mod_node_name   ,
+            &module         ,
+            &node           ,
+            errorno
+        );
+        
+        if ( ret == RET_NO_NODE )
+        {
+            sysfunc = get_sys_node( runtime , mod_node_name );
+            
+            if ( sysfunc != NULL )
+            {
+                ret = RET_OK;
+            }
+        }
+        
+        if ( ( ret == RET_OK ) && ( cache != NULL ) )
+        {
+            /* read the generation after the lookup, */
+            /* it may have loaded a module */
+            cache->generation = runtime->node_generation;
+            cache->caller = oldcontext.module;
+            cache->module = module;
+            cache->node = node;
+            cache->sysfunc = sysfunc;
+        }
+    }
+    
+    if ( ( ret == RET_OK ) && ( node != NULL ) )
+    {
+        ret = invoke_user_node(
+            runtime             ,
+            mod_node_name       ,
+            module              ,
+            node                ,
+            paramvalue          ,
+            paramvalue_count    ,
+            retvalue            ,
+            retvalue_count      ,
+            errorno
+        );
+    }
+    else if ( ret == RET_OK )
     {
         memset( &node_param , 0 , sizeof( NODE_PARAM ) );
         
@@ -614,11 +815,12 @@ SLINT call_node(
             node_param.list = paramvalue;
         }
         
+        memcpy( &runtime->caller , &oldcontext , sizeof( CALLCONTEXT ) );
         runtime->current.param = &node_param;
         runtime->current.retvalue = retvalue;
         runtime->current.retvalue_count = retvalue_count;
         
-        ret = call_sys_node( runtime , mod_node_name );
+        ret = sysfunc( runtime );
     }
     
     if ( ret == RET_RETURN )
@@ -639,28 +841,40 @@ SLINT call_node(
         log_error( "call '%s' error(%d)" , mod_node_name , ret );
     }
     
+    memstats_charge( oldcharge );
     return ret;
 }
 
+SLINT call_node(
+    RUNTIME*        runtime             ,
+    bchar*          mod_node_name       ,
+    PARAM_ITEM*     paramvalue          ,
+    SLINT           paramvalue_count    ,
+    PARAM_ITEM*     retvalue            ,
+    SLINT           retvalue_count      ,
+    SLINT*          errorno
+) {
+    return call_node_cached(
+        runtime             ,
+        NULL                ,
+        mod_node_name       ,
+        paramvalue          ,
+        paramvalue_count    ,
+        retvalue            ,
+        retvalue_count      ,
+        errorno
+    );
+}
+
 bchar* get_cvalue_string( NODE_PARAM* param , CODE_VALUE* value )
 {
-    PARAM_ITEM* item = param->list;
+    RT_VALUE*   item;
     bchar*      ret = NULL;
     
     if ( value->type == CVT_VARIABLE )
     {
-        item = &(item[value->index]);
-        
-        if ( item->value != NULL )
-        {
-            if ( item->value->type == RVT_STRING )
-            {
-                if ( item->value->data != NULL )
-                {
-                    ret = item->value->data;
-                }
-            }
-        }
+        item = PARAM_VALUE( param , value->index );
+        ret = value_cstr( item );
     }
     else if ( value->type == CVT_CONST )
     {
@@ -675,165 +889,162 @@ bchar* get_cvalue_string( NODE_PARAM* param , CODE_VALUE* value )
     return ret;
 }
 
-bchar* eval_format( RUNTIME* runtime , CODE_VALUE* value )
-{
-    bchar* ret = get_cvalue_string( runtime->current.param , value );
-    return strformat(
-        runtime->current.param ,
-        ret
-    );
-}
-
-typedef struct _FOREACH_CALLBACK_PARM
-{
-    RUNTIME*        runtime;
-    CODE*           code;
-    SLINT*          errorno;
-
-    PARAM_ITEM*     iterator;
-    PARAM_ITEM*     iterator_value;
-    SLINT           step;
-    SLINT           stepi;
-    SLINT           ret;
-}
-FOREACH_CALLBACK_PARM;
-
-SLINT foreach_callback( bchar* name , void* data , void* param )
-{
-    SLINT                   ret;
-    FOREACH_CALLBACK_PARM*  run_code_param = ( FOREACH_CALLBACK_PARM* )param;
+/*
+an integer key is written to buf, so indexing does not keep its text,
+len counts the key's bytes including any zero ones
+*/
+bchar* get_cvalue_key(
+    NODE_PARAM* param   ,
+    CODE_VALUE* value   ,
+    bchar*      buf     ,
+    SLINT       size    ,
+    SLINT*      len
+) {
+    RT_VALUE*   item;
+    bchar*      ret;
     
-    if ( run_code_param->step > 1 )
+    if ( value->type == CVT_VARIABLE )
     {
-        run_code_param->stepi++;
+        item = PARAM_VALUE( param , value->index );
         
-        if ( run_code_param->stepi > run_code_param->step )
+        if ( ( item != NULL )
+            && ( item->type == RVT_INT64 )
+            && ( item->data == NULL ) )
         {
-            run_code_param->stepi = 1;
+            *len = snprintf( buf , size , "%lld" , item->num.i );
+            return buf;
         }
         
-        if ( run_code_param->stepi != 1 )
+        ret = value_cstr( item );
+        
+        if ( ret != NULL )
         {
-            return 1;
+            *len = item->size;
         }
-    }
-    
-    unref_value( run_code_param->runtime , run_code_param->iterator->value );
-    run_code_param->iterator->value = ref_value_str(
-        run_code_param->runtime ,
-        name ,
-        strlen( name ) ,
-        1
-    );
-    
-    if ( run_code_param->iterator_value )
-    {
-        unref_value(
-            run_code_param->runtime ,
-            run_code_param->iterator_value->value
-        );
         
-        run_code_param->iterator_value->value = ref_value(
-            run_code_param->runtime ,
-            data
-        );
+        return ret;
     }
     
-    ret = run_code(
-        run_code_param->runtime ,
-        run_code_param->code ,
-        run_code_param->errorno
-    );
+    ret = get_cvalue_string( param , value );
     
-    if ( ret == 0 )
+    if ( ret != NULL )
     {
-        run_code_param->ret = ret;
-        return 0;
+        *len = strlen( ret );
     }
-    else if ( ret == 2 )
+    
+    return ret;
+}
+
+EVAL_CACHE* runtime_eval_cache( RUNTIME* runtime )
+{
+    /* the cached slots belong to nodes that may have changed */
+    if ( runtime->eval_cache_generation != runtime->node_generation )
     {
-        run_code_param->ret = ret;
-        return 0;
+        eval_cache_clear( runtime->eval_cache );
+        runtime->eval_cache_generation = runtime->node_generation;
     }
     
-    return 1;
+    return runtime->eval_cache;
 }
 
-SLINT run_foreach( RUNTIME* runtime , CODE* code , SLINT* errorno )
+bchar* eval_format( RUNTIME* runtime , CODE_VALUE* value , SLINT* len )
 {
-    SLINT       ret;
-    CODE_VALUE* val_array;
-    CODE_VALUE* valueptr;
-    CODE*       foreachcode;
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* paramptr;
-    PARAM_ITEM* iterator;
-    PARAM_ITEM* iterator_value;
-    SLINT       step;
-    bchar       stepchar;
-    bchar*      stepstr;
-    bchar*      stepfind;
-    bchar*      pstr;
-    SLINT       str_size;
-    SLINT       pos;
-    SLINT       c;
-    SLINT       start_pos;
-    SLINT       i;
+    bchar*  str;
+    bchar*  ret;
     
-    if ( code->val_array_count < 3 )
+    if ( value->type == CVT_FORMAT )
     {
-        *errorno = __LINE__;
-        return RET_ERROR;
+        return run_strformat( runtime->current.param , value->data , len );
     }
     
-    val_array = code->value;
-    paramarray = runtime->current.param->list;
-    step = 1;
-    iterator_value = NULL;
-    
-    valueptr = &(val_array[code->val_array_count-1]);
+    str = get_cvalue_string( runtime->current.param , value );
     
-    if ( valueptr->type != CVT_CODE )
+    if ( str == NULL )
     {
-        *errorno = __LINE__;
-        return RET_ERROR;
+        return NULL;
     }
     
-    foreachcode = valueptr->data;
-    
-    valueptr = &(val_array[0]);
+    ret = eval_cache_format(
+        runtime_eval_cache( runtime ) ,
+        runtime->current.param ,
+        str ,
+        len
+    );
     
-    if ( valueptr->type != CVT_VARIABLE )
+    if ( ret == NULL )
     {
-        *errorno = __LINE__;
-        return RET_ERROR;
+        log_error( "error" );
+        ret = dup_str( "error" );
+        *len = strlen( ret );
     }
     
-    iterator = &(paramarray[valueptr->index]);
-    
-    if ( code->val_array_count >= 4 )
+    return ret;
+}
+
+typedef struct _FOREACH_STATE
+{
+    SLINT           active;
+    RT_VALUE*       source;     /* held until the loop ends */
+    RT_VALUE**      iterator;
+    RT_VALUE**      iterator_value;
+    SLINT           step;
+    bchar           stepchar;
+    bchar*          stepstr;
+    SLINT           steplen;
+    bchar*          pstr;
+    SLINT           str_size;
+    SLINT           pos;
+    SLINT           ascii_end;  /* no byte above 0x7F from pos to here */
+    SLINT           i;
+    HFMAP           table;
+    FMAP_ITER       iter;
+    SLINT           stepi;
+}
+FOREACH_STATE;
+
+void foreach_end( RUNTIME* runtime , FOREACH_STATE* state )
+{
+    if ( state->active )
     {
-        valueptr = &(val_array[1]);
-        
-        if ( valueptr->type != CVT_VARIABLE )
+        /* a loop left early still has its walk open */
+        if ( state->table != NULL )
         {
-            *errorno = __LINE__;
-            return RET_ERROR;
+            fmap_iter_end( state->table , &state->iter );
         }
         
-        iterator_value = &(paramarray[valueptr->index]);
+        unref_value( runtime , state->source );
+        memset( state , 0 , sizeof( FOREACH_STATE ) );
+    }
+}
+
+SLINT foreach_begin(
+    RUNTIME*        runtime ,
+    CODE*           code    ,
+    FOREACH_STATE*  state   ,
+    SLINT*          errorno
+) {
+    CODE_VALUE*     val_array;
+    CODE_VALUE*     valueptr;
+    NODE_PARAM*     param;
+    RT_VALUE*       source;
+    SLINT           pos;
+    SLINT           c;
+    
+    foreach_end( runtime , state );
+    
+    val_array = code->value;
+    param = runtime->current.param;
+    state->step = 1;
+    state->iterator = &PARAM_VALUE( param , val_array[0].index );
+    
+    if ( code->val_array_count >= 4 )
+    {
+        state->iterator_value = &PARAM_VALUE( param , val_array[1].index );
     }
     
     if ( code->val_array_count == 5 )
     {
         valueptr = &(val_array[2]);
-        
-        if ( valueptr->type != CVT_CONST )
-        {
-            *errorno = __LINE__;
-            return RET_ERROR;
-        }
-        
         pos = 0;
         c = shift_word_skip_space(
             valueptr->data ,
@@ -843,303 +1054,288 @@ SLINT run_foreach( RUNTIME* runtime , CODE* code , SLINT* errorno )
         
         if ( c == '*' )
         {
-            step = -1;  /* space as separator */
-            stepchar = ' ';
+            state->step = -1;   /* space as separator */
+            state->stepchar = ' ';
         }
         else if ( c == '-' )
         {
-            step = -2;  /* custom separator (line feed) */
-            stepchar = '\n';
+            state->step = -2;   /* custom separator (line feed) */
+            state->stepchar = '\n';
         }
         else if ( ! is_number( c ) )
         {
-            step = -2;  /* custom delimiter */
-            stepchar = c;
-            stepstr = valueptr->data;
-            start_pos = strlen( stepstr );
+            state->step = -2;   /* custom delimiter */
+            state->stepchar = c;
+            state->stepstr = valueptr->data;
+            state->steplen = strlen( state->stepstr );
             
-            if ( start_pos > 1 )
+            if ( state->steplen > 1 )
             {
-                step = -3;  /* custom delimited string */
+                state->step = -3;   /* custom delimited string */
             }
         }
         else
         {
-            step = atoi( valueptr->data );
+            state->step = atoi( valueptr->data );
             
-            if ( step <= 0 )
+            if ( state->step <= 0 )
             {
-                step = 1;
+                state->step = 1;
             }
         }
     }
     
-    pstr = NULL;
-    str_size = 0;
-    
     valueptr = &(val_array[code->val_array_count - 2]);
     
     if ( valueptr->type == CVT_CONST )
     {
-        pstr = valueptr->data;
-        str_size = strlen( pstr );
+        state->pstr = valueptr->data;
+        state->str_size = strlen( state->pstr );
     }
     else if ( valueptr->type == CVT_VARIABLE )
     {
-        paramptr = &(paramarray[valueptr->index]);
+        source = PARAM_VALUE( param , valueptr->index );
         
-        if ( ( paramptr->value != NULL ) && ( paramptr->value->data != NULL ) )
+        if ( ( source != NULL ) && ( value_cstr( source ) != NULL ) )
         {
-            if ( paramptr->value->type == RVT_STRING )
-            {
-                pstr = paramptr->value->data;
-                str_size = paramptr->value->size;
-            }
-            else if ( paramptr->value->type == RVT_TABLE )
+            state->pstr = source->data;
+            state->str_size = source->size;
+            state->source = ref_value( runtime , source );
+        }
+        else if ( ( source != NULL )
+            && ( source->type == RVT_TABLE )
+            && ( source->data != NULL ) )
+        {
+            if ( state->step <= 0 )
             {
-                if ( step <= 0 )
-                {
-                    step = 1;
-                }
-                
-                FOREACH_CALLBACK_PARM foreach_param = { 0 };
-                foreach_param.runtime = runtime;
-                foreach_param.code = foreachcode;
-                foreach_param.errorno = errorno;
-                foreach_param.iterator = iterator;
-                foreach_param.iterator_value = iterator_value;
-                foreach_param.step = step;
-                foreach_param.stepi = 0;
-                foreach_param.ret = 1;
-                
-                dmap_foreach(
-                    paramptr->value->data ,
-                    foreach_callback ,
-                    &foreach_param
-                );
-                
-                if ( foreach_param.ret != RET_OK )
-                {
-                    return foreach_param.ret;
-                }
+                state->step = 1;
             }
+            
+            state->table = source->data;
+            fmap_iter_init( state->table , &state->iter );
+            state->source = ref_value( runtime , source );
+            state->active = 1;
+            return RET_OK;
         }
     }
     
-    if ( ( pstr != NULL ) && ( str_size > 0 ) )
+    if ( ( state->pstr != NULL ) && ( state->str_size > 0 ) )
     {
-        ret = 1;
-        
-        if ( step <= 0 )
-        {
-            pos = 0;
-            i = 0;
-            
-            if ( step == -1 ) /* space as separator */
+        state->active = 1;
+    }
+    else
+    {
+        unref_value( runtime , state->source );
+        state->source = NULL;
+    }
+    
+    return RET_OK;
+}
+
+void foreach_set_value(
+    RUNTIME*        runtime ,
+    FOREACH_STATE*  state   ,
+    bchar*          str     ,
+    SLINT           size
+) {
+    if ( state->iterator_value )
+    {
+        unref_value( runtime , *state->iterator_value );
+        *state->iterator_value = ref_value_slice(
+            runtime ,
+            state->source ,
+            str ,
+            size
+        );
+    }
+}
+
+/* return 1 when the iterator holds the next item */
+SLINT foreach_next( RUNTIME* runtime , FOREACH_STATE* state )
+{
+    bchar*          pstr;
+    SLINT           str_size;
+    bchar*          key;
+    void*           data;
+    SLINT           start_pos;
+    SLINT           k;
+    SLINT           n;
+    
+    if ( ! state->active )
+    {
+        return 0;
+    }
+    
+    pstr = state->pstr;
+    str_size = state->str_size;
+    
+    if ( state->table != NULL )
+    {
+        while ( fmap_iter_next( state->table , &state->iter , &key , &data ) )
+        {
+            if ( state->step > 1 )
             {
-                while ( TRUE )
+                state->stepi++;
+                
+                if ( state->stepi > state->step )
                 {
-                    c = shift_word_skip_space(
-                        pstr ,
-                        str_size ,
-                        &pos
-                    );
-                    
-                    if ( c == 0 )
-                    {
-                        break;
-                    }
-                    
-                    start_pos = pos - 1;
-                    
-                    while ( ! is_space(
-                        c = shift_word(
-                            pstr ,
-                            str_size ,
-                            &pos
-                        )
-                    ) && ( c != 0 ) );
-                    
-                    i++;
-                    
-                    if ( iterator_value )
-                    {
-                        unref_value( runtime , iterator_value->value );
-                        iterator_value->value = ref_value_str(
-                            runtime ,
-                            pstr + start_pos ,
-                            pos - 1 - start_pos ,
-                            1
-                        );
-                    }
-                    
-                    unref_value( runtime , iterator->value );
-                    iterator->value = ref_value_int( runtime , i );
-                    
-                    ret = run_code( runtime , foreachcode , errorno );
-                    
-                    if ( ( ret == 0 ) || ( ret == 2 ) )
-                    {
-                        break;
-                    }
+                    state->stepi = 1;
                 }
-            }
-            else if ( step == -2 )    /* custom delimiter */
-            {
-                while ( TRUE )
+                
+                if ( state->stepi != 1 )
                 {
-                    start_pos = pos;
-                    
-                    while ( ( ( c = shift_word(
-                        pstr ,
-                        str_size ,
-                        &pos
-                    ) ) != stepchar ) && c != 0 );
-                    
-                    if ( pos <= start_pos )
-                    {
-                        break;
-                    }
-                    
-                    i++;
-                    
-                    if ( iterator_value )
-                    {
-                        unref_value( runtime , iterator_value->value );
-                        
-                        if ( c == 0 )
-                        {
-                            iterator_value->value = ref_value_str(
-                                runtime ,
-                                pstr + start_pos ,
-                                pos - start_pos ,
-                                1
-                            );
-                        }
-                        else
-                        {
-                            iterator_value->value = ref_value_str(
-                                runtime ,
-                                pstr + start_pos ,
-                                pos - 1 - start_pos ,
-                                1
-                            );
-                        }
-                    }
-                    
-                    unref_value( runtime , iterator->value );
-                    iterator->value = ref_value_int( runtime , i );
-                    
-                    ret = run_code( runtime , foreachcode , errorno );
-                    
-                    if ( ( ret == 0 ) || ( ret == 2 ) )
-                    {
-                        break;
-                    }
+                    continue;
                 }
             }
-            else if ( step == -3 )  /* custom delimited string */
+            
+            unref_value( runtime , *state->iterator );
+            *state->iterator = ref_value_str(
+                runtime ,
+                key ,
+                state->iter.keylen ,
+                1
+            );
+            
+            if ( state->iterator_value )
             {
-                while ( TRUE )
-                {
-                    stepfind = strstr( pstr , stepstr );
-                    
-                    if ( stepfind == NULL )
-                    {
-                        pos = str_size;
-                        str_size = 0;
-                    }
-                    else
-                    {
-                        pos = stepfind - pstr;
-                        str_size -= ( pos + start_pos );
-                    }
-                    
-                    i++;
-                    
-                    if ( iterator_value )
-                    {
-                        unref_value( runtime , iterator_value->value );
-                        iterator_value->value = ref_value_str(
-                            runtime ,
-                            pstr ,
-                            pos ,
-                            1
-                        );
-                    }
-                    
-                    unref_value( runtime , iterator->value );
-                    iterator->value = ref_value_int( runtime , i );
-                    
-                    ret = run_code( runtime , foreachcode , errorno );
-                    
-                    if ( ( ret == 0 ) || ( ret == 2 ) )
-                    {
-                        break;
-                    }
-                    
-                    if ( str_size > 0 )
-                    {
-                        pstr = stepfind + start_pos;
-                    }
-                    else
-                    {
-                        break;
-                    }
-                }
+                unref_value( runtime , *state->iterator_value );
+                *state->iterator_value = ref_value( runtime , data );
             }
+            
+            return 1;
         }
-        else
+    }
+    else if ( state->step == -1 )   /* space as separator */
+    {
+        start_pos = state->pos + strscan_nonspace(
+            pstr + state->pos ,
+            str_size - state->pos
+        );
+        
+        if ( start_pos < str_size )
+        {
+            state->pos = start_pos + strscan_space(
+                pstr + start_pos ,
+                str_size - start_pos
+            );
+            
+            state->i++;
+            foreach_set_value(
+                runtime ,
+                state ,
+                pstr + start_pos ,
+                state->pos - start_pos
+            );
+            
+            unref_value( runtime , *state->iterator );
+            *state->iterator = ref_value_int( runtime , state->i );
+            return 1;
+        }
+    }
+    else if ( state->step == -2 )   /* custom delimiter */
+    {
+        if ( state->pos < str_size )
+        {
+            start_pos = state->pos;
+            k = strscan_byte(
+                pstr + start_pos ,
+                str_size - start_pos ,
+                state->stepchar
+            );
+            
+            /* past the delimiter, or past the end when there was none */
+            state->pos = start_pos + k + 1;
+            
+            state->i++;
+            foreach_set_value( runtime , state , pstr + start_pos , k );
+            
+            unref_value( runtime , *state->iterator );
+            *state->iterator = ref_value_int( runtime , state->i );
+            return 1;
+        }
+    }
+    else if ( state->step == -3 )   /* custom delimited string */
+    {
+        if ( state->pos >= 0 )
         {
-            pos = 0;
+            k = strscan_find( pstr , str_size , state->stepstr , state->steplen );
             
-            while ( pos < str_size )
+            if ( k >= str_size )
             {
-                start_pos = pos;
-                
-                for ( i = 0; i < step; i++ )
-                {
-                    c = shift_word(
-                        pstr ,
-                        str_size ,
-                        &pos
-                    );
-                }
-                
-                if ( iterator_value )
-                {
-                    unref_value( runtime , iterator_value->value );
-                    iterator_value->value = ref_value_str(
-                        runtime ,
-                        pstr + start_pos ,
-                        pos - start_pos ,
-                        1
-                    );
-                }
-                
-                unref_value( runtime , iterator->value );
-                iterator->value = ref_value_int( runtime , pos );
-                
-                ret = run_code( runtime , foreachcode , errorno );
-                
-                if ( ( ret == 0 ) || ( ret == 2 ) )
-                {
-                    break;
-                }
+                state->str_size = 0;
+            }
+            else
+            {
+                state->str_size -= ( k + state->steplen );
             }
+            
+            state->i++;
+            foreach_set_value( runtime , state , pstr , k );
+            
+            unref_value( runtime , *state->iterator );
+            *state->iterator = ref_value_int( runtime , state->i );
+            
+            if ( state->str_size > 0 )
+            {
+                state->pstr = pstr + k + state->steplen;
+            }
+            else
+            {
+                state->pos = -1;    /* last item */
+            }
+            
+            return 1;
         }
+    }
+    else if ( state->pos < str_size )
+    {
+        start_pos = state->pos;
+        k = 0;
         
-        if ( ret != RET_OK )
+        /* runs of ASCII are stepped over whole, one byte per character */
+        while ( ( k < state->step ) && ( state->pos < str_size ) )
         {
-            return ret;
+            if ( state->pos >= state->ascii_end )
+            {
+                state->ascii_end = state->pos + strscan_nonascii(
+                    pstr + state->pos ,
+                    str_size - state->pos
+                );
+            }
+            
+            if ( state->pos < state->ascii_end )
+            {
+                n = MIN( state->step - k , state->ascii_end - state->pos );
+                state->pos += n;
+                k += n;
+            }
+            else
+            {
+                shift_word( pstr , str_size , &state->pos );
+                k++;
+            }
         }
+        
+        foreach_set_value(
+            runtime ,
+            state ,
+            pstr + start_pos ,
+            state->pos - start_pos
+        );
+        
+        unref_value( runtime , *state->iterator );
+        *state->iterator = ref_value_int( runtime , state->pos );
+        return 1;
     }
     
-    return RET_OK;
+    foreach_end( runtime , state );
+    return 0;
 }
 
+/* parent holds str, NULL when it is not a value */
 RT_VALUE* get_sub_string(
     RUNTIME*    runtime     ,
+    RT_VALUE*   parent      ,
     bchar*      str         ,
     SLINT       str_size    ,
     bchar*      key
@@ -1265,133 +1461,122 @@ RT_VALUE* get_sub_string(
         return NULL;
     }
     
-    return ref_value_str(
+    return ref_value_slice(
         runtime ,
+        parent ,
         str + nkeystart ,
-        (nkeyend - nkeystart) + 1 ,
-        1
+        (nkeyend - nkeystart) + 1
     );
 }
 
-SLINT run_equ( RUNTIME* runtime , CODE* code , SLINT* errorno )
+/* numbers stay numbers, only text results become strings */
+RT_VALUE* ref_value_scalar( RUNTIME* runtime , EVAL_SCALAR* scalar )
 {
-    CODE_VALUE* val_array;
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* dest;
-    PARAM_ITEM* src;
+    bchar*      text;
+    SLINT       size;
     
-    val_array = code->value;
-    paramarray = runtime->current.param->list;
-    
-    if ( val_array[0].type == CVT_VARIABLE )
+    if ( scalar->type == EST_INT )
     {
-        dest = &(paramarray[val_array[0].index]);
-        
-        if ( val_array[1].type == CVT_VARIABLE )
-        {
-            src = &(paramarray[val_array[1].index]);
-            
-            if ( dest->value != src->value )
-            {
-                unref_value( runtime , dest->value );
-                dest->value = ref_value( runtime , src->value );
-            }
-        }
-        else if ( val_array[1].type == CVT_CONST )
-        {
-            unref_value( runtime , dest->value );
-            dest->value = ref_value_str(
-                runtime ,
-                val_array[1].data ,
-                strlen( val_array[1].data ) ,
-                1
-            );
-        }
-        else if ( val_array[1].type == CVT_INIT )
-        {
-            unref_value( runtime , dest->value );
-            dest->value = NULL;
-        }
+        eval_scalar_free( scalar );
+        return ref_value_int64( runtime , scalar->i );
     }
-    else
+    else if ( scalar->type == EST_DOUBLE )
     {
-        *errorno = __LINE__;
-        return RET_ERROR;
+        eval_scalar_free( scalar );
+        return ref_value_double( runtime , scalar->d );
     }
     
-    return RET_OK;
+    text = eval_scalar_detach( scalar );
+    size = strlen( text );
+    
+    if ( size == 0 )
+    {
+        memfree( text );
+        text = NULL;
+    }
+    
+    return ref_value_str( runtime , text , size , 0 );
+}
+
+/* expression text, compiled once per node and kept in the runtime cache */
+SLINT run_evaluate_text( RUNTIME* runtime , bchar* str , EVAL_SCALAR* result )
+{
+    return eval_cache_run(
+        runtime_eval_cache( runtime ) ,
+        runtime->current.param ,
+        str ,
+        result
+    );
 }
 
 SLINT run_eval( RUNTIME* runtime , CODE* code , SLINT* errorno )
 {
-    bchar*      evalres = NULL;
+    SLINT       evalok = 0;
+    EVAL_SCALAR evalres;
     CODE_VALUE* val_array;
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* dest;
-    PARAM_ITEM* src;
+    NODE_PARAM* param;
+    RT_VALUE**  dest;
+    bchar*      src;
+    RT_VALUE*   value;
     
     val_array = code->value;
-    paramarray = runtime->current.param->list;
+    param = runtime->current.param;
     
     if ( val_array[0].type == CVT_VARIABLE )
     {
-        dest = &(paramarray[val_array[0].index]);
+        dest = &PARAM_VALUE( param , val_array[0].index );
         
         if ( val_array[1].type == CVT_VARIABLE )
         {
-            src = &(paramarray[val_array[1].index]);
+            src = value_cstr( PARAM_VALUE( param , val_array[1].index ) );
             
-            if ( ( src->value != NULL )
-                && ( src->value->type == RVT_STRING )
-                && ( src->value->data != NULL ) )
+            if ( src != NULL )
             {
-                evalres = evaluate(
-                    runtime->current.param ,
-                    src->value->data
-                );
+                evalok = run_evaluate_text( runtime , src , &evalres );
             }
         }
         else if ( val_array[1].type == CVT_CONST )
         {
-            evalres = evaluate(
-                runtime->current.param ,
-                val_array[1].data
-            );
+            evalok = run_evaluate_text( runtime , val_array[1].data , &evalres );
         }
         else if ( val_array[1].type == CVT_EVAL )
         {
-            evalres = run_evaluate(
+            evalok = run_evaluate_scalar(
                 runtime->current.param ,
-                val_array[1].data
+                val_array[1].data ,
+                &evalres
             );
         }
     }
     
-    if ( evalres == NULL )
+    if ( ! evalok )
     {
         *errorno = __LINE__;
         return RET_ERROR;
     }
     
-    unref_value( runtime , dest->value );
-    dest->value = ref_value_str( runtime , evalres , strlen( evalres ) , 0 );
+    /* the result can still point into the old value of dest */
+    value = ref_value_scalar( runtime , &evalres );
+    unref_value( runtime , *dest );
+    *dest = value;
     return RET_OK;
 }
 
 SLINT run_format( RUNTIME* runtime , CODE* code , SLINT* errorno )
 {
     bchar*      evalres = NULL;
+    SLINT       len = 0;
     CODE_VALUE* val_array;
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* dest;
+    NODE_PARAM* param;
+    RT_VALUE**  dest;
     
     val_array = code->value;
-    paramarray = runtime->current.param->list;
+    param = runtime->current.param;
     
     if ( val_array[0].type == CVT_VARIABLE )
     {
-        dest = &(paramarray[val_array[0].index]);
-        evalres = eval_format( runtime , &val_array[1] );
+        dest = &PARAM_VALUE( param , val_array[0].index );
+        evalres = eval_format( runtime , &val_array[1] , &len );
     }
     
     if ( evalres == NULL )
@@ -1400,198 +1585,73 @@ SLINT run_format( RUNTIME* runtime , CODE* code , SLINT* errorno )
         return RET_ERROR;
     }
     
-    unref_value( runtime , dest->value );
-    dest->value = ref_value_str( runtime , evalres , strlen( evalres ) , 0 );
+    unref_value( runtime , *dest );
+    *dest = ref_value_str( runtime , evalres , len , 0 );
+    
+    /* an empty result is a null value that does not keep the text */
+    if ( len == 0 )
+    {
+        memfree( evalres );
+    }
+    
     return RET_OK;
 }
 
-SLINT run_if( RUNTIME* runtime , CODE* code , SLINT* errorno )
-{
-    bchar*      evalres = NULL;
-    SLINT       evalrescode = 0;
-    CODE_VALUE* val_array;
-    CODE_VALUE* valueptr;
-    SLINT       subret;
-    
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* evalitem;
-    SLINT       i;
-    
-    val_array = code->value;
-    paramarray = runtime->current.param->list;
-    
-    i = 0;
+/* strict: a failed evaluation is an error instead of false */
+SLINT eval_condition(
+    RUNTIME*        runtime ,
+    CODE_VALUE*     valueptr ,
+    SLINT           strict  ,
+    SLINT*          result  ,
+    SLINT*          errorno
+) {
+    SLINT           evalok = 0;
+    EVAL_SCALAR     evalres;
+    bchar*          evalstr;
     
-    while ( i < code->val_array_count )
+    if ( valueptr->type == CVT_VARIABLE )
     {
-        evalres = NULL;
-        valueptr = &(val_array[i]);
-        
-        if ( valueptr->type != CVT_CODE )
-        {
-            if ( valueptr->type == CVT_VARIABLE )
-            {
-                evalitem = &(paramarray[valueptr->index]);
-                
-                if ( ( evalitem->value != NULL )
-                    && ( evalitem->value->type == RVT_STRING )
-                    && ( evalitem->value->data != NULL ) )
-                {
-                    evalres = evaluate(
-                        runtime->current.param ,
-                        evalitem->value->data
-                    );
-                }
-            }
-            else if ( valueptr->type == CVT_CONST )
-            {
-                evalres = evaluate(
-                    runtime->current.param ,
-                    valueptr->data
-                );
-            }
-            else if ( valueptr->type == CVT_EVAL )
-            {
-                evalres = run_evaluate(
-                    runtime->current.param ,
-                    valueptr->data
-                );
-            }
-            
-            if ( evalres == NULL )
-            {
-                evalrescode = 0;
-            }
-            else
-            {
-                evalrescode = 0;
-                evalrescode = (*evalres == '1');
-                memfree( evalres );
-            }
-            
-            i++;
-            valueptr = &(val_array[i]);
-            
-            if ( valueptr->type != CVT_CODE )
-            {
-                *errorno = __LINE__;
-                return RET_ERROR;
-            }
-        }
-        else
-        {
-            evalrescode = 1;
-        }
+        evalstr = value_cstr(
+            PARAM_VALUE( runtime->current.param , valueptr->index )
+        );
         
-        if ( evalrescode )
+        if ( evalstr != NULL )
         {
-            subret = run_code( runtime , valueptr->data , errorno );
-            
-            if ( subret != RET_OK )
-            {
-                return subret;
-            }
-            
-            break;
+            evalok = run_evaluate_text( runtime , evalstr , &evalres );
         }
-        else
+        else if ( strict )
         {
-            i++;
+            evalok = run_evaluate_text( runtime , "0" , &evalres );
         }
     }
-    
-    return RET_OK;
-}
-
-SLINT run_while( RUNTIME* runtime , CODE* code , SLINT* errorno )
-{
-    bchar*      evalres = NULL;
-    SLINT       evalrescode = 0;
-    CODE_VALUE* val_array;
-    CODE_VALUE* valueptr;
-    CODE_VALUE* subcodeptr;
-    SLINT       subret;
-    
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* evalitem;
-    
-    val_array = code->value;
-    paramarray = runtime->current.param->list;
-    
-    subcodeptr = &(val_array[1]);
-    
-    if ( subcodeptr->type != CVT_CODE )
+    else if ( valueptr->type == CVT_CONST )
     {
-        *errorno = __LINE__;
-        return RET_ERROR;
+        evalok = run_evaluate_text( runtime , valueptr->data , &evalres );
+    }
+    else if ( valueptr->type == CVT_EVAL )
+    {
+        evalok = run_evaluate_scalar(
+            runtime->current.param ,
+            valueptr->data ,
+            &evalres
+        );
     }
     
-    valueptr = &(val_array[0]);
-    
-    while ( TRUE )
+    if ( ! evalok )
     {
-        evalres = NULL;
+        *result = 0;
         
-        if ( valueptr->type == CVT_VARIABLE )
-        {
-            evalitem = &(paramarray[valueptr->index]);
-            
-            if ( ( evalitem->value != NULL )
-                && ( evalitem->value->type == RVT_STRING )
-                && ( evalitem->value->data != NULL ) )
-            {
-                evalres = evaluate(
-                    runtime->current.param ,
-                    evalitem->value->data
-                );
-            }
-            else
-            {
-                evalres = evaluate(
-                    runtime->current.param ,
-                    "0"
-                );
-            }
-        }
-        else if ( valueptr->type == CVT_CONST )
-        {
-            evalres = evaluate(
-                runtime->current.param ,
-                valueptr->data
-            );
-        }
-        else if ( valueptr->type == CVT_EVAL )
-        {
-            evalres = run_evaluate(
-                runtime->current.param ,
-                valueptr->data
-            );
-        }
-        
-        if ( evalres == NULL )
+        if ( strict )
         {
             *errorno = __LINE__;
             return RET_ERROR;
         }
         
-        evalrescode = (*evalres == '1');
-        memfree( evalres );
-        
-        if ( evalrescode )
-        {
-            subret = run_code( runtime , subcodeptr->data , errorno );
-            
-            if ( subret != RET_OK )
-            {
-                return subret;
-            }
-        }
-        else
-        {
-            break;
-        }
+        return RET_OK;
     }
     
+    *result = eval_scalar_truth( &evalres );
+    eval_scalar_free( &evalres );
     return RET_OK;
 }
 
@@ -1601,11 +1661,11 @@ SLINT run_return( RUNTIME* runtime , CODE* code , SLINT* errorno )
     CODE_VALUE* val_array;
     CODE_VALUE* valueptr;
     
-    PARAM_ITEM* paramarray;
+    NODE_PARAM* param;
     PARAM_ITEM* retitemptr;
     
     val_array = code->value;
-    paramarray = runtime->current.param->list;
+    param = runtime->current.param;
     
     if ( code->val_array_count > 0 )
     {
@@ -1623,18 +1683,13 @@ SLINT run_return( RUNTIME* runtime , CODE* code , SLINT* errorno )
                 
                 if ( valueptr->type == CVT_CONST )
                 {
-                    retitemptr->value = ref_value_str(
-                        runtime ,
-                        valueptr->data ,
-                        strlen( valueptr->data ) ,
-                        1
-                    );
+                    retitemptr->value = ref_value_const( runtime , valueptr );
                 }
                 else if ( valueptr->type == CVT_VARIABLE )
                 {
                     retitemptr->value = ref_value(
                         runtime ,
-                        paramarray[valueptr->index].value
+                        PARAM_VALUE( param , valueptr->index )
                     );
                 }
             }
@@ -1644,21 +1699,25 @@ SLINT run_return( RUNTIME* runtime , CODE* code , SLINT* errorno )
     return RET_RETURN;
 }
 
-SLINT run_call( RUNTIME* runtime , CODE* code , SLINT* errorno )
-{
+SLINT run_call(
+    RUNTIME*    runtime ,
+    CODE*       code    ,
+    CALL_CACHE* cache   ,
+    SLINT*      errorno
+) {
     SLINT       i;
     bchar*      node_name;
     CODE_VALUE* val_array;
     CODE_VALUE* valueptr;
     
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* itemptr;
+    NODE_PARAM* param;
+    RT_VALUE**  itemptr;
     PARAM_ITEM* subparamarray;
     PARAM_ITEM* subretarray;
     SLINT       subret;
     
     val_array = code->value;
-    paramarray = runtime->current.param->list;
+    param = runtime->current.param;
     
     node_name = NULL;
     
@@ -1668,14 +1727,8 @@ SLINT run_call( RUNTIME* runtime , CODE* code , SLINT* errorno )
     }
     else if ( val_array[0].type == CVT_VARIABLE )
     {
-        itemptr = &(paramarray[val_array[0].index]);
-        
-        if ( ( itemptr->value != NULL )
-            && ( itemptr->value->type == RVT_STRING )
-            && ( itemptr->value->data != NULL ) )
-        {
-            node_name = itemptr->value->data;
-        }
+        itemptr = &PARAM_VALUE( param , val_array[0].index );
+        node_name = value_cstr( *itemptr );
     }
     
     if ( node_name == NULL )
@@ -1689,27 +1742,11 @@ SLINT run_call( RUNTIME* runtime , CODE* code , SLINT* errorno )
     SLINT call_param_count = val_array[1].index / 1000;
     SLINT call_return_count = val_array[1].index % 1000;
     
-    if ( call_param_count > 0 )
-    {
-        subparamarray = memalloc_zero(
-            sizeof( PARAM_ITEM ) * call_param_count
-        );
-    }
-    else
-    {
-        subparamarray = NULL;
-    }
-    
-    if ( call_return_count > 0 )
-    {
-        subretarray = memalloc_zero(
-            sizeof( PARAM_ITEM ) * call_return_count
-        );
-    }
-    else
-    {
-        subretarray = NULL;
-    }
+    subparamarray = frame_push(
+        runtime ,
+        sizeof( PARAM_ITEM ) * ( call_param_count + call_return_count )
+    );
+    subretarray = subparamarray + call_param_count;
     
     for ( i = 0; i < call_param_count; i++ )
     {
@@ -1718,18 +1755,13 @@ SLINT run_call( RUNTIME* runtime , CODE* code , SLINT* errorno )
         
         if ( valueptr->type == CVT_CONST )
         {
-            subparamarray[i].value = ref_value_str(
-                runtime ,
-                valueptr->data ,
-                strlen( valueptr->data ) ,
-                1
-            );
+            subparamarray[i].value = ref_value_const( runtime , valueptr );
         }
         else if ( valueptr->type == CVT_VARIABLE )
         {
             subparamarray[i].value = ref_value(
                 runtime ,
-                runtime->current.param->list[valueptr->index].value
+                PARAM_VALUE( param , valueptr->index )
             );
         }
     }
@@ -1739,55 +1771,39 @@ SLINT run_call( RUNTIME* runtime , CODE* code , SLINT* errorno )
         /*TODO:  asynchronous call*/
     }
     
-    subret = call_node(
-        runtime ,
-        node_name ,
-        subparamarray ,
-        call_param_count ,
-        subretarray ,
-        call_return_count ,
+    subret = call_node_cached(
+        runtime             ,
+        cache               ,
+        node_name           ,
+        subparamarray       ,
+        call_param_count    ,
+        subretarray         ,
+        call_return_count   ,
         errorno
     );
     
-    if ( subparamarray != NULL )
-    {
-        free_param_list_value( runtime , subparamarray , call_param_count );
-        free_param_list( subparamarray , call_param_count );
-    }
+    free_param_list_value( runtime , subparamarray , call_param_count );
     
-    if ( subret != RET_OK )
+    if ( subret == RET_OK )
     {
-        if ( subretarray )
+        for ( i = 0; i < call_return_count; i++ )
         {
-            free_param_list_value( runtime , subretarray , call_return_count );
-            free_param_list( subretarray , call_return_count );
-        }
-        
-        return subret;
-    }
-    
-    for ( i = 0; i < call_return_count; i++ )
-    {
-        CODE_VALUE* pretvalue = &(val_array[2 + call_param_count + i]);
-        
-        if ( pretvalue->type == CVT_VARIABLE )
-        {
-            unref_value( runtime , paramarray[pretvalue->index].value );
-            paramarray[pretvalue->index].value = ref_value(
-                runtime ,
-                subretarray[i].value
-            );
+            CODE_VALUE* pretvalue = &(val_array[2 + call_param_count + i]);
+            
+            if ( pretvalue->type == CVT_VARIABLE )
+            {
+                unref_value( runtime , PARAM_VALUE( param , pretvalue->index ) );
+                PARAM_VALUE( param , pretvalue->index ) = ref_value(
+                    runtime ,
+                    subretarray[i].value
+                );
+            }
         }
-        
-        unref_value( runtime , subretarray[i].value );
-    }
-    
-    if ( subretarray )
-    {
-        memfree( subretarray );
     }
     
-    return RET_OK;
+    free_param_list_value( runtime , subretarray , call_return_count );
+    frame_pop( runtime , subparamarray );
+    return subret;
 }
 
 SLINT run_getitemcount( RUNTIME* runtime , CODE* code , SLINT* errorno )
@@ -1795,56 +1811,56 @@ SLINT run_getitemcount( RUNTIME* runtime , CODE* code , SLINT* errorno )
     CODE_VALUE* val_array;
     CODE_VALUE* valueptr;
     
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* dest;
-    PARAM_ITEM* src;
+    NODE_PARAM* param;
+    RT_VALUE**  dest;
+    RT_VALUE**  src;
     SLINT       subret;
     
     val_array = code->value;
-    paramarray = runtime->current.param->list;
+    param = runtime->current.param;
     
     valueptr = &(val_array[0]);
     
     if ( valueptr->type == CVT_VARIABLE )
     {
-        dest = &(paramarray[valueptr->index]);
+        dest = &PARAM_VALUE( param , valueptr->index );
         
         valueptr = &(val_array[1]);
         
         if ( valueptr->type == CVT_VARIABLE )
         {
-            src = &(paramarray[valueptr->index]);
+            src = &PARAM_VALUE( param , valueptr->index );
             
-            if ( src->value != NULL )
+            if ( *src != NULL )
             {
-                if ( src->value->type == RVT_TABLE )
+                if ( (*src)->type == RVT_TABLE )
                 {
-                    subret = dmap_getcount( src->value->data );
-                    unref_value( runtime , dest->value );
-                    dest->value = ref_value_int( runtime , subret );
+                    subret = fmap_getcount( (*src)->data );
+                    unref_value( runtime , *dest );
+                    *dest = ref_value_int( runtime , subret );
                 }
-                else if ( src->value->type == RVT_STRING )
+                else if ( value_cstr( *src ) != NULL )
                 {
-                    unref_value( runtime , dest->value );
-                    dest->value = ref_value_int( runtime , src->value->size );
+                    unref_value( runtime , *dest );
+                    *dest = ref_value_int( runtime , (*src)->size );
                 }
                 else
                 {
-                    unref_value( runtime , dest->value );
-                    dest->value = ref_value_int( runtime , 0 );
+                    unref_value( runtime , *dest );
+                    *dest = ref_value_int( runtime , 0 );
                 }
             }
             else
             {
-                unref_value( runtime , dest->value );
-                dest->value = ref_value_int( runtime , 0 );
+                unref_value( runtime , *dest );
+                *dest = ref_value_int( runtime , 0 );
             }
         }
         else if ( valueptr->type == CVT_CONST )
         {
             subret = strlen( val_array[1].data );
-            unref_value( runtime , dest->value );
-            dest->value = ref_value_int( runtime , subret );
+            unref_value( runtime , *dest );
+            *dest = ref_value_int( runtime , subret );
         }
         else
         {
@@ -1852,9 +1868,9 @@ SLINT run_getitemcount( RUNTIME* runtime , CODE* code , SLINT* errorno )
             return RET_ERROR;
         }
         
-        if ( dest->value == NULL )
+        if ( *dest == NULL )
         {
-            dest->value = ref_value_int( runtime , 0 );
+            *dest = ref_value_int( runtime , 0 );
         }
     }
     else
@@ -1869,79 +1885,92 @@ SLINT run_getitemcount( RUNTIME* runtime , CODE* code , SLINT* errorno )
 SLINT run_getitem( RUNTIME* runtime , CODE* code , SLINT* errorno )
 {
     bchar*      evalstr;
+    SLINT       evallen;
+    bchar       keybuf[24];
     CODE_VALUE* val_array;
     CODE_VALUE* valueptr;
     
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* dest;
-    PARAM_ITEM* src;
+    NODE_PARAM* param;
+    RT_VALUE**  dest;
+    RT_VALUE**  src;
     
     val_array = code->value;
-    paramarray = runtime->current.param->list;
-    
-    evalstr = get_cvalue_string( runtime->current.param , &val_array[2] );
+    param = runtime->current.param;
+    
+    evalstr = get_cvalue_key(
+        param           ,
+        &val_array[2]   ,
+        keybuf          ,
+        24              ,
+        &evallen
+    );
     valueptr = &(val_array[0]);
     
     if ( ( evalstr != NULL ) && ( valueptr->type == CVT_VARIABLE ) )
     {
-        dest = &(paramarray[valueptr->index]);
+        dest = &PARAM_VALUE( param , valueptr->index );
         
         valueptr = &(val_array[1]);
         
         if ( valueptr->type == CVT_VARIABLE )
         {
-            src = &(paramarray[valueptr->index]);
+            src = &PARAM_VALUE( param , valueptr->index );
             
-            if ( src->value != NULL )
+            if ( *src != NULL )
             {
-                if ( src->value->type == RVT_TABLE )
+                if ( (*src)->type == RVT_TABLE )
                 {
-                    RT_VALUE* subitem = dmap_query(
-                        src->value->data ,
-                        evalstr
+                    RT_VALUE* subitem = fmap_query_len(
+                        (*src)->data ,
+                        evalstr ,
+                        evallen
                     );
                     
                     if ( subitem != NULL )
                     {
-                        if ( dest->value != subitem )
+                        if ( *dest != subitem )
                         {
-                            unref_value( runtime , dest->value );
-                            dest->value = ref_value( runtime , subitem );
+                            unref_value( runtime , *dest );
+                            *dest = ref_value( runtime , subitem );
                         }
                     }
                     else
                     {
-                        unref_value( runtime , dest->value );
-                        dest->value = NULL;
+                        unref_value( runtime , *dest );
+                        *dest = NULL;
                     }
                 }
-                else if ( src->value->type == RVT_STRING )
+                else if ( value_cstr( *src ) != NULL )
                 {
-                    unref_value( runtime , dest->value );
-                    dest->value = get_sub_string(
+                    /* dest may be src, the slice takes its ref first */
+                    RT_VALUE* substr = get_sub_string(
                         runtime ,
-                        src->value->data ,
-                        src->value->size ,
+                        *src ,
+                        (*src)->data ,
+                        (*src)->size ,
                         evalstr
                     );
+                    unref_value( runtime , *dest );
+                    *dest = substr;
                 }
                 else
                 {
-                    unref_value( runtime , dest->value );
-                    dest->value = NULL;
+                    unref_value( runtime , *dest );
+                    *dest = NULL;
                 }
             }
             else
             {
-                unref_value( runtime , dest->value );
-                dest->value = NULL;
+                unref_value( runtime , *dest );
+                *dest = NULL;
             }
         }
         else if ( valueptr->type == CVT_CONST )
         {
-            unref_value( runtime , dest->value );
-            dest->value = get_sub_string(
+            unref_value( runtime , *dest );
+            *dest = get_sub_string(
                 runtime ,
+                NULL ,
                 valueptr->data ,
                 strlen( valueptr->data ) ,
                 evalstr
@@ -1966,29 +1995,37 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
 {
     SLINT       i;
     bchar*      evalstr;
+    SLINT       evallen;
+    bchar       keybuf[24];
     CODE_VALUE* val_array;
     CODE_VALUE* valueptr;
     
-    PARAM_ITEM* paramarray;
-    PARAM_ITEM* dest;
-    PARAM_ITEM* src;
+    NODE_PARAM* param;
+    RT_VALUE**  dest;
+    RT_VALUE**  src;
     
     val_array = code->value;
-    paramarray = runtime->current.param->list;
-    
-    evalstr = get_cvalue_string( runtime->current.param , &val_array[1] );
+    param = runtime->current.param;
+    
+    evalstr = get_cvalue_key(
+        param           ,
+        &val_array[1]   ,
+        keybuf          ,
+        24              ,
+        &evallen
+    );
     valueptr = &(val_array[0]);
     
     if ( ( evalstr != NULL ) && ( valueptr->type == CVT_VARIABLE ) )
     {
-        dest = &(paramarray[valueptr->index]);
+        dest = &PARAM_VALUE( param , valueptr->index );
         
-        if ( dest->value == NULL )
+        if ( *dest == NULL )
         {
-            dest->value = new_table_value( runtime );
+            *dest = new_table_value( runtime );
         }
         
-        if ( dest->value->type == RVT_STRING )
+        if ( value_cstr( *dest ) != NULL )
         {
             valueptr = &(val_array[2]);
             bchar* strparam = NULL;
@@ -1996,15 +2033,14 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
             
             if ( valueptr->type == CVT_VARIABLE )
             {
-                src = &(paramarray[valueptr->index]);
+                src = &PARAM_VALUE( param , valueptr->index );
                 
-                if ( src->value != NULL )
+                if ( *src != NULL )
                 {
-                    if ( ( src->value->type == RVT_STRING )
-                        && ( src->value->data != NULL ) )
+                    if ( value_cstr( *src ) != NULL )
                     {
-                        strparam = src->value->data;
-                        strparamsize = src->value->size;
+                        strparam = (*src)->data;
+                        strparamsize = (*src)->size;
                     }
                     else
                     {
@@ -2041,21 +2077,34 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
             
             if ( ( strparam != NULL ) && ( i >= 0 ) )
             {
-                SLINT len = dest->value->size;
+                SLINT len = (*dest)->size;
+                
+                /* an unshared string grows in place */
+                if ( value_str_splice(
+                    runtime ,
+                    *dest ,
+                    MIN( i , len ) ,
+                    ( i < len ) ? 1 : 0 ,
+                    strparam ,
+                    strparamsize
+                ) )
+                {
+                    return RET_OK;
+                }
                 
                 if ( i < len )
                 {
                     bchar* newstr = memalloc_zero( len + strparamsize );
-                    memcpy( newstr , dest->value->data , i );
+                    memcpy( newstr , (*dest)->data , i );
                     memcpy( newstr + i , strparam , strparamsize );
                     memcpy(
                         newstr + i + strparamsize ,
-                        dest->value->data + i + 1 ,
+                        (*dest)->data + i + 1 ,
                         len - i - 1
                     );
                     
-                    unref_value( runtime , dest->value );
-                    dest->value = ref_value_str(
+                    unref_value( runtime , *dest );
+                    *dest = ref_value_str(
                         runtime ,
                         newstr ,
                         len + strparamsize - 1 ,
@@ -2065,11 +2114,11 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
                 else
                 {
                     bchar* newstr = memalloc_zero( len + strparamsize + 1 );
-                    memcpy( newstr , dest->value->data , len );
+                    memcpy( newstr , (*dest)->data , len );
                     memcpy( newstr + len , strparam , strparamsize );
                     
-                    unref_value( runtime , dest->value );
-                    dest->value = ref_value_str(
+                    unref_value( runtime , *dest );
+                    *dest = ref_value_str(
                         runtime ,
                         newstr ,
                         len + strparamsize ,
@@ -2080,10 +2129,10 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
         }
         else
         {
-            if ( dest->value->type != RVT_TABLE )
+            if ( (*dest)->type != RVT_TABLE )
             {
-                unref_value( runtime , dest->value );
-                dest->value = new_table_value( runtime );
+                unref_value( runtime , *dest );
+                *dest = new_table_value( runtime );
             }
             
             valueptr = &(val_array[2]);
@@ -2091,17 +2140,12 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
             
             if ( valueptr->type == CVT_VARIABLE )
             {
-                src = &(paramarray[valueptr->index]);
-                pnewitem = ref_value( runtime , src->value );
+                src = &PARAM_VALUE( param , valueptr->index );
+                pnewitem = ref_value( runtime , *src );
             }
             else if ( valueptr->type == CVT_CONST )
             {
-                pnewitem = ref_value_str(
-                    runtime ,
-                    valueptr->data ,
-                    strlen( valueptr->data ) ,
-                    1
-                );
+                pnewitem = ref_value_const( runtime , valueptr );
             }
             else if ( valueptr->type == CVT_INIT )
             {
@@ -2114,7 +2158,11 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
                 return RET_ERROR;
             }
             
-            RT_VALUE* polditem = dmap_query( dest->value->data , evalstr );
+            RT_VALUE* polditem = fmap_query_len(
+                (*dest)->data ,
+                evalstr ,
+                evallen
+            );
             
             if ( polditem != NULL )
             {
@@ -2124,13 +2172,18 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
                     
                     if ( pnewitem != NULL )
                     {
-                        dmap_insert( dest->value->data , evalstr , pnewitem );
-                        update_value( runtime , dest->value );
+                        fmap_insert_len(
+                            (*dest)->data ,
+                            evalstr ,
+                            evallen ,
+                            pnewitem
+                        );
+                        update_value( runtime , *dest );
                     }
                     else
                     {
-                        dmap_erase( dest->value->data , evalstr );
-                        update_value( runtime , dest->value );
+                        fmap_erase_len( (*dest)->data , evalstr , evallen );
+                        update_value( runtime , *dest );
                     }
                 }
                 else
@@ -2140,8 +2193,8 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
             }
             else if ( pnewitem != NULL )
             {
-                dmap_insert( dest->value->data , evalstr , pnewitem );
-                update_value( runtime , dest->value );
+                fmap_insert_len( (*dest)->data , evalstr , evallen , pnewitem );
+                update_value( runtime , *dest );
             }
         }
     }
@@ -2153,60 +2206,185 @@ SLINT run_setitem( RUNTIME* runtime, CODE* code , SLINT* errorno )
     return RET_OK;
 }
 
-SLINT run_code( RUNTIME* runtime , CODE* code , SLINT* errorno )
+#ifdef BC_COMPUTED_GOTO
+    #define BC_CASE( op )           L_##op
+    #define BC_DISPATCH()           goto *bc_labels[ ip->op ]
+#else
+    #define BC_CASE( op )           case op
+    #define BC_DISPATCH()           continue
+#endif
+
+SLINT run_bytecode( RUNTIME* runtime , BYTECODE* bytecode , SLINT* errorno )
 {
-    SLINT subret = RET_OK;
-    
-    while ( code )
-    {
-        switch ( code->op )
-        {
-        case OP_EQU:
-            subret = run_equ( runtime , code , errorno );
-            break;
-        case OP_EVALUATE:
-            subret = run_eval( runtime , code , errorno );
-            break;
-        case OP_STRFORMAT:
-            subret = run_format( runtime , code , errorno );
-            break;
-        case OP_IF:
-            subret = run_if( runtime , code , errorno );
-            break;
-        case OP_WHILE:
-            subret = run_while( runtime , code , errorno );
-            break;
-        case OP_RETURN:
-            subret = run_return( runtime , code , errorno );
-            break;
-        case OP_CALL:
-            subret = run_call( runtime , code , errorno );
-            break;
-        case OP_GETITEMCOUNT:
-            subret = run_getitemcount( runtime , code , errorno );
-            break;
-        case OP_GETITEM:
-            subret = run_getitem( runtime , code , errorno );
-            break;
-        case OP_SETITEM:
-            subret = run_setitem( runtime , code , errorno );
-            break;
-        case OP_FOREACH:
-            subret = run_foreach( runtime , code , errorno );
-            break;
-        case OP_NOOP:
-            break;
-        default:
-            break;
+#ifdef BC_COMPUTED_GOTO
+    static void*    bc_labels[BC_OP_COUNT] = {
+        &&L_BC_END ,
+        &&L_BC_MOVE ,
+        &&L_BC_LOADK ,
+        &&L_BC_CLEAR ,
+        &&L_BC_EVALUATE ,
+        &&L_BC_STRFORMAT ,
+        &&L_BC_RETURN ,
+        &&L_BC_CALL ,
+        &&L_BC_GETITEMCOUNT ,
+        &&L_BC_GETITEM ,
+        &&L_BC_SETITEM ,
+        &&L_BC_JUMP ,
+        &&L_BC_JUMPFALSE ,
+        &&L_BC_FOREACH ,
+        &&L_BC_FOREACHNEXT ,
+        &&L_BC_FAIL
+    };
+#endif
+    BC_INSTR*       base;
+    BC_INSTR*       ip;
+    NODE_PARAM*     param;
+    FOREACH_STATE*  states;
+    RT_VALUE**      dest;
+    RT_VALUE*       src;
+    SLINT           ret;
+    SLINT           cond;
+    SLINT           i;
+    
+    base = bytecode->instr;
+    ip = base;
+    param = runtime->current.param;
+    ret = RET_OK;
+    states = frame_push(
+        runtime ,
+        sizeof( FOREACH_STATE ) * bytecode->foreach_depth
+    );
+    
+#ifdef BC_COMPUTED_GOTO
+    BC_DISPATCH();
+#else
+    while ( TRUE )
+    {
+        switch ( ip->op )
+        {
+#endif
+    BC_CASE( BC_END ):
+        goto bc_exit;
+    
+    BC_CASE( BC_MOVE ):
+        dest = &PARAM_VALUE( param , ip->a );
+        src = PARAM_VALUE( param , ip->b );
+        
+        if ( *dest != src )
+        {
+            unref_value( runtime , *dest );
+            *dest = ref_value( runtime , src );
+        }
+        
+        ip++;
+        BC_DISPATCH();
+    
+    BC_CASE( BC_LOADK ):
+        dest = &PARAM_VALUE( param , ip->a );
+        unref_value( runtime , *dest );
+        *dest = ref_value_const( runtime , ip->value );
+        ip++;
+        BC_DISPATCH();
+    
+    BC_CASE( BC_CLEAR ):
+        dest = &PARAM_VALUE( param , ip->a );
+        unref_value( runtime , *dest );
+        *dest = NULL;
+        ip++;
+        BC_DISPATCH();
+    
+    BC_CASE( BC_EVALUATE ):
+        ret = run_eval( runtime , ip->code , errorno );
+        goto bc_next;
+    
+    BC_CASE( BC_STRFORMAT ):
+        ret = run_format( runtime , ip->code , errorno );
+        goto bc_next;
+    
+    BC_CASE( BC_RETURN ):
+        ret = run_return( runtime , ip->code , errorno );
+        goto bc_exit;
+    
+    BC_CASE( BC_CALL ):
+        ret = run_call(
+            runtime ,
+            ip->code ,
+            ( ip->a >= 0 ) ? &bytecode->call_cache[ ip->a ] : NULL ,
+            errorno
+        );
+        goto bc_next;
+    
+    BC_CASE( BC_GETITEMCOUNT ):
+        ret = run_getitemcount( runtime , ip->code , errorno );
+        goto bc_next;
+    
+    BC_CASE( BC_GETITEM ):
+        ret = run_getitem( runtime , ip->code , errorno );
+        goto bc_next;
+    
+    BC_CASE( BC_SETITEM ):
+        ret = run_setitem( runtime , ip->code , errorno );
+        goto bc_next;
+    
+    BC_CASE( BC_JUMP ):
+        ip = base + ip->c;
+        BC_DISPATCH();
+    
+    BC_CASE( BC_JUMPFALSE ):
+        ret = eval_condition( runtime , ip->value , ip->b , &cond , errorno );
+        
+        if ( ret != RET_OK )
+        {
+            goto bc_exit;
+        }
+        
+        ip = cond ? ( ip + 1 ) : ( base + ip->c );
+        BC_DISPATCH();
+    
+    BC_CASE( BC_FOREACH ):
+        ret = foreach_begin( runtime , ip->code , &states[ip->a] , errorno );
+        goto bc_next;
+    
+    BC_CASE( BC_FOREACHNEXT ):
+        if ( foreach_next( runtime , &states[ip->a] ) )
+        {
+            ip++;
+        }
+        else
+        {
+            ip = base + ip->c;
         }
         
-        if ( subret != RET_OK )
+        BC_DISPATCH();
+    
+    BC_CASE( BC_FAIL ):
+        *errorno = ip->a;
+        ret = RET_ERROR;
+        goto bc_exit;
+    
+    bc_next:
+        if ( ret != RET_OK )
         {
-            return subret;
+            goto bc_exit;
         }
         
-        code = code->next;
+        ip++;
+        BC_DISPATCH();
+#ifndef BC_COMPUTED_GOTO
+        default:
+            *errorno = __LINE__;
+            ret = RET_ERROR;
+            goto bc_exit;
+        }
     }
+#endif
     
-    return RET_OK;
+bc_exit:
+    for ( i = 0; i < bytecode->foreach_depth; i++ )
+    {
+        foreach_end( runtime , &states[i] );
+    }
+    
+    frame_pop( runtime , states );
+    return ret;
 }
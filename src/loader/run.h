@@ -18,9 +18,13 @@
 
 #include "memalloc.h"
 #include "map.h"
+#include "map_flat.h"
 #include "map_int.h"
 #include "list.h"
 #include "slang.h"
+#include "evalcache.h"
+#include "gc.h"
+#include "drop.h"
 
 enum MODULE_TYPE
 {
@@ -34,7 +38,7 @@ struct _MODULE
 {
     NODE*       node;
     HDMAP       nodemap; /* NODE */
-    char        name[MAX_NAME_LEN];
+    char*       name;    /* interned */
     int         modtype;
     void*       handle;
 };
@@ -51,6 +55,31 @@ struct _CALLCONTEXT
     int         retvalue_count;
 };
 
+#define FRAME_CHUNK_SIZE        ( 64 * 1024 )
+
+typedef struct _FRAME_CHUNK     FRAME_CHUNK;
+
+struct _FRAME_CHUNK
+{
+    FRAME_CHUNK*    prev;
+    UINT            size;
+    UINT            top;
+    char            data[1];
+};
+
+typedef struct _CALL_CACHE      CALL_CACHE;
+
+/* resolved target of a constant-name call site, valid while */
+/* generation matches runtime->node_generation */
+struct _CALL_CACHE
+{
+    UINT        generation;
+    MODULE*     caller;
+    MODULE*     module;
+    NODE*       node;
+    EXTFUNC     sysfunc;
+};
+
 typedef struct _RUNTIME         RUNTIME;
 
 struct _RUNTIME
@@ -64,11 +93,30 @@ struct _RUNTIME
     /*memory*/
     int         total_ref;
     HDLIST      hdelvalue;
+    RT_VALUE*   bool_value[2];  /* shared "0" and "1" */
+    MEM_POOL*   pool;           /* RT_VALUE blocks, shared by temp runtimes */
+    GC_STATE*   gc;             /* tables that may sit on a dead cycle */
+    DROP_QUEUE* drop;           /* released tables still to be emptied */
+    MEM_STATS*  mem;            /* charged while it runs, shared by temp runtimes */
+    INT64       mem_soft_limit; /* live bytes, 0 for none */
+    INT64       mem_hard_limit;
+    SLINT       mem_soft_warned;
+    
+    /* call frame stack */
+    FRAME_CHUNK* frame;
+    FRAME_CHUNK* frame_spare;
     
     /* call context*/
     CALLCONTEXT current;
     CALLCONTEXT caller;
     
+    /* bumped whenever a node may be added or replaced */
+    UINT        node_generation;
+    
+    /* compiled expressions that only exist as text */
+    EVAL_CACHE* eval_cache;
+    UINT        eval_cache_generation;
+    
     int         errorno;
     
     /*root table*/
@@ -84,6 +132,12 @@ RUNTIME* new_runtime( char* basepath );
 
 int release_runtime( RUNTIME* runtime );
 
+/*
+past soft a warning is logged once, past hard every node call fails until
+the process is back under it, 0 turns a limit off
+*/
+void runtime_set_memlimit( RUNTIME* runtime , INT64 soft , INT64 hard );
+
 MODULE* load_module( RUNTIME* runtime , char* name );
 
 MODULE* load_module_from_node( RUNTIME* runtime , char* name , NODE* node );
@@ -98,6 +152,17 @@ int call_node(
     int*        errorno
 );
 
+int call_node_cached(
+    RUNTIME*    runtime ,
+    CALL_CACHE* cache ,
+    char*       mod_node_name ,
+    PARAM_ITEM* value ,
+    int         value_count ,
+    PARAM_ITEM* retvalue ,
+    int         retvalue_count ,
+    int*        errorno
+);
+
 void free_node_data( RUNTIME* runtime , NODE* node );
 
 void free_param_list_value( RUNTIME* runtime , PARAM_ITEM* list , int count );
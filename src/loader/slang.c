@@ -13,6 +13,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  * */
 
+#define MEMALLOC_CATEGORY   MEMCAT_CODE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -26,6 +28,7 @@
 #include "errorstr.h"
 #include "slang.h"
 #include "slanglex.h"
+#include "eval.h"
 
 typedef struct _CODE_PARSE_STATUS   CODE_PARSE_STATUS;
 
@@ -1402,6 +1405,48 @@ void value_link_to_array( NODE_PARAM* param )
     param->list = valuearray;
 }
 
+/*
+a constant expression is compiled once here, anything that fails to
+compile stays text and reports its error when it runs
+*/
+static void compile_eval_value( CODE_PARSE_STATUS* pcps , CODE_VALUE* cvalue )
+{
+    EVAL_PROG*  prog;
+    
+    if ( ( cvalue->type != CVT_CONST ) || ( cvalue->data == NULL ) )
+    {
+        return;
+    }
+    
+    prog = compile_evaluate( pcps->param , cvalue->data );
+    
+    if ( prog != NULL )
+    {
+        memfree( cvalue->data );
+        cvalue->data = prog;
+        cvalue->type = CVT_EVAL;
+    }
+}
+
+static void compile_format_value( CODE_PARSE_STATUS* pcps , CODE_VALUE* cvalue )
+{
+    EVAL_FORMAT*    format;
+    
+    if ( ( cvalue->type != CVT_CONST ) || ( cvalue->data == NULL ) )
+    {
+        return;
+    }
+    
+    format = compile_strformat( pcps->param , cvalue->data );
+    
+    if ( format != NULL )
+    {
+        memfree( cvalue->data );
+        cvalue->data = format;
+        cvalue->type = CVT_FORMAT;
+    }
+}
+
 static BOOL parse_expression(
     CODE_PARSE_STATUS*  pcps            ,
     CLAUSE*             pfirst_clause   ,
@@ -1520,6 +1565,11 @@ static BOOL parse_expression(
                     cvalue->data = pfollow_clause->constvalue;
                     pfollow_clause->constvalue = NULL;
                     cvalue->type = CVT_CONST;
+                    
+                    if ( pcps->cur_code->op == OP_EVALUATE )
+                    {
+                        compile_eval_value( pcps , cvalue );
+                    }
                 }
                 else
                 {
@@ -1545,6 +1595,7 @@ static BOOL parse_expression(
                     cvalue->data = pfollow_clause->constvalue;
                     pfollow_clause->constvalue = NULL;
                     cvalue->type = CVT_CONST;
+                    compile_format_value( pcps , cvalue );
                 }
                 else
                 {
@@ -1919,6 +1970,7 @@ static BOOL parse_statement(
             cvalue->data = pfollow_clause->constvalue;
             pfollow_clause->constvalue = NULL;
             cvalue->type = CVT_CONST;
+            compile_eval_value( pcps , cvalue );
         }
         else
         {
@@ -1995,6 +2047,7 @@ static BOOL parse_statement(
                     cvalue->data = pfollow_clause->constvalue;
                     pfollow_clause->constvalue = NULL;
                     cvalue->type = CVT_CONST;
+                    compile_eval_value( pcps , cvalue );
                 }
                 
                 cvalue->next = memalloc_zero( sizeof( CODE_VALUE ) );
@@ -2053,6 +2106,7 @@ static BOOL parse_statement(
             cvalue->data = pfollow_clause->constvalue;
             pfollow_clause->constvalue = NULL;
             cvalue->type = CVT_CONST;
+            compile_eval_value( pcps , cvalue );
         }
         else
         {
@@ -2237,6 +2291,7 @@ NODE* parse_source_buffer(
     PARAM_ITEM* tempvalue;
     int         paramstep;
     int         nps;
+    char        nodename[MAX_WORD_NAME_LEN];
     
     pos                 = 0;
     *errstartpos        = pos;
@@ -2308,10 +2363,11 @@ NODE* parse_source_buffer(
             }
             
             wstrncpy(
-                cur_node->name                      ,
+                nodename                            ,
                 src_buf + start_pos                 ,
                 MIN( MAX_WORD_NAME_LEN - 1 , len )
             );
+            cur_node->name = intern_name( nodename , -1 );
             
             shift_space_comment( src_buf , src_fsize , &pos );
             
@@ -2395,11 +2451,7 @@ NODE* parse_source_buffer(
                 tempvalue = ( PARAM_ITEM* )tempvalue->value;
             }
             
-            strncpy(
-                tempvalue->name                 ,
-                src_buf + start_pos             ,
-                MIN( MAX_NAME_LEN - 1 , len )
-            );
+            tempvalue->name = intern_name( src_buf + start_pos , len );
             
             if ( dmap_query( cur_node->param->hmap , tempvalue->name ) != NULL )
             {
@@ -38,6 +38,10 @@
 #define CODE_EXT_FILENAME       ".sc"
 #define DATA_DUMP_DATANAME      "sl.data"
 
+/* a .sc file starts with these, one without them is parsed from source */
+#define CODE_MAGIC              0x43534C53  /* "SLSC" */
+#define CODE_VERSION            2
+
 #ifdef WINDOWS
     #define LIB_EXT_FILENAME    ".dll"
 #else
@@ -103,7 +107,8 @@ enum CODE_VALUE_TYPE
     CVT_CONST               = 2 ,
     CVT_CODE                = 3 ,
     CVT_EVAL                = 4 ,
-    CVT_INIT                = 5
+    CVT_INIT                = 5 ,
+    CVT_FORMAT              = 6
 };
 
 typedef struct _CODE_VALUE  CODE_VALUE;
@@ -113,6 +118,8 @@ struct _CODE_VALUE
     int                     type;   /* CODE_VALUE_TYPE */
     int                     index;
     void*                   data;
+    void*                   shared; /* CVT_CONST: its pinned RT_VALUE, */
+                                    /* held until the module goes */
     CODE_VALUE*             next;
 };
 
@@ -141,9 +148,19 @@ enum RT_VALUE_TYPE
     RVT_NULL                = 0 ,
     RVT_STRING              = 1 ,
     RVT_TABLE               = 2 ,
-    RVT_TBL_ITEM_UNLOAD     = 3
+    RVT_TBL_ITEM_UNLOAD     = 3 ,
+    RVT_INT64               = 4 , /* num.i, data is its text once read */
+    RVT_DOUBLE              = 5 , /* num.d, data is its text once read */
+    RVT_SLICE               = 6   /* data points into num.parent's text */
 };
 
+/* values that read as a string */
+#define RVT_IS_SCALAR( type )                                           \
+    ( ( ( type ) == RVT_STRING )                                        \
+        || ( ( type ) == RVT_INT64 )                                    \
+        || ( ( type ) == RVT_DOUBLE )                                   \
+        || ( ( type ) == RVT_SLICE ) )
+
 typedef struct _RT_VALUE    RT_VALUE;
 
 struct _RT_VALUE
@@ -152,14 +169,23 @@ struct _RT_VALUE
     UINT                    size;
     void*                   data;
     UINT                    ref;
+    UINT                    gc;     /* cycle collector flags */
     UINT64                  fpos;
+    union
+    {
+        INT64               i;
+        double              d;
+        INT64               capacity;   /* RVT_STRING: bytes at data, */
+                                        /* 0 when just size + 1 */
+        RT_VALUE*           parent;     /* RVT_SLICE: holds the text */
+    }                       num;
 };
 
 typedef struct _PARAM_ITEM  PARAM_ITEM;
 
 struct _PARAM_ITEM
 {
-    char                    name[MAX_NAME_LEN];
+    char*                   name;   /* interned */
     RT_VALUE*               value;
 };
 
@@ -172,13 +198,25 @@ struct _NODE_PARAM
     UINT                    count1;
     UINT                    count2;
     void*                   hmap;
+    RT_VALUE**              frame;  /* values of the first list while */
+                                    /* the node is running */
 };
 
+/* value slot of a parameter, the first list lives in the call frame */
+#define PARAM_VALUE( param , i )                                        \
+    ( *( ( ( ( param )->frame != NULL )                                 \
+        && ( ( UINT )( i ) < ( param )->count1 ) )                      \
+        ? &( ( param )->frame[ i ] )                                    \
+        : &( ( param )->list[ i ].value ) ) )
+
+typedef struct _BYTECODE    BYTECODE;
+
 typedef struct _NODE_BODY   NODE_BODY;
 
 struct _NODE_BODY
 {
     CODE*                   code;
+    BYTECODE*               bytecode;   /* code lowered for run_bytecode */
 };
 
 enum NODE_TYPE
@@ -193,8 +231,8 @@ enum NODE_STATUS
     NS_INIT                 = 0 , /* default */
     NS_LOADDATA             = 1
 };
-
-typedef struct _RUNTIME     RUNTIME;
+
+typedef struct _RUNTIME     RUNTIME;
 
 typedef int (* EXTFUNC )( RUNTIME* runtime );
 
@@ -202,7 +240,7 @@ typedef struct _NODE        NODE;
 
 struct _NODE
 {
-    char                    name[MAX_WORD_NAME_LEN];
+    char*                   name;   /* interned */
     NODE_PARAM*             param;
     NODE_BODY*              body;
     int                     status;
@@ -213,6 +251,11 @@ struct _NODE
 
 void free_node( NODE* node );
 
+/* one shared copy of a name, len < 0 takes the whole string */
+char* intern_name( const char* name , int len );
+
+void free_names();
+
 int dump_node( NODE* node , char* dest_file );
 
 NODE* parse_source_file( char* filename );
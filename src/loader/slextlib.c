@@ -34,6 +34,27 @@ SLINT slext_get_count( RUNTIME* runtime )
     return runtime->current.param->count;
 }
 
+SLINT slext_value_int( RT_VALUE* value )
+{
+    if ( value != NULL )
+    {
+        if ( value->type == RVT_INT64 )
+        {
+            return ( SLINT )value->num.i;
+        }
+        else if ( value->type == RVT_DOUBLE )
+        {
+            return ( SLINT )value->num.d;
+        }
+        else if ( value_cstr( value ) != NULL )
+        {
+            return atoi( value->data );
+        }
+    }
+    
+    return 0;
+}
+
 SLINT slext_get_int( RUNTIME* runtime , SLINT i )
 {
     PARAM_ITEM* paramlist;
@@ -41,15 +62,33 @@ SLINT slext_get_int( RUNTIME* runtime , SLINT i )
     if ( ( i >= 0 ) && ( runtime->current.param->count > i ) )
     {
         paramlist = &(runtime->current.param->list[i]);
+        return slext_value_int( paramlist->value );
+    }
+    
+    return 0;
+}
+
+double slext_get_double( RUNTIME* runtime , SLINT i )
+{
+    RT_VALUE*   value;
+    
+    if ( ( i >= 0 ) && ( runtime->current.param->count > i ) )
+    {
+        value = runtime->current.param->list[i].value;
         
-        if ( paramlist->value != NULL )
+        if ( value != NULL )
         {
-            if ( paramlist->value->type == RVT_STRING )
+            if ( value->type == RVT_DOUBLE )
             {
-                if ( paramlist->value->data != NULL )
-                {
-                    return atoi( paramlist->value->data );
-                }
+                return value->num.d;
+            }
+            else if ( value->type == RVT_INT64 )
+            {
+                return ( double )value->num.i;
+            }
+            else if ( value_cstr( value ) != NULL )
+            {
+                return atof( value->data );
             }
         }
     }
@@ -67,9 +106,9 @@ char* slext_get_ptr( RUNTIME* runtime , SLINT i , SLINT* outsize )
         
         if ( paramlist->value != NULL )
         {
-            if ( paramlist->value->type == RVT_STRING )
+            if ( RVT_IS_SCALAR( paramlist->value->type ) )
             {
-                if ( paramlist->value->data != NULL )
+                if ( value_cstr( paramlist->value ) != NULL )
                 {
                     if ( outsize )
                     {
@@ -141,6 +180,21 @@ SLINT slext_set_int( RUNTIME* runtime , SLINT i , SLINT value )
     return 0;
 }
 
+SLINT slext_set_double( RUNTIME* runtime , SLINT i , double value )
+{
+    if ( ( runtime->current.retvalue_count > i ) && ( i >= 0 ) )
+    {
+        unref_value( runtime , runtime->current.retvalue[i].value );
+        runtime->current.retvalue[i].value = ref_value_double(
+            runtime ,
+            value
+        );
+        return 1;
+    }
+    
+    return 0;
+}
+
 SLINT slext_set_ptr(
     RUNTIME*    runtime ,
     SLINT       i       ,
@@ -148,6 +202,12 @@ SLINT slext_set_ptr(
     SLINT       size    ,
     SLINT       bcopy
 ) {
+    /* the extension's buffer is freed with the value from now on */
+    if ( ! bcopy )
+    {
+        memadopt( str , MEMCAT_VALUE );
+    }
+    
     if ( ( runtime->current.retvalue_count > i ) && ( i >= 0 ) )
     {
         unref_value( runtime , runtime->current.retvalue[i].value );
@@ -303,7 +363,7 @@ SLINT slext_tbl_get_int( SLRUNTIME runtime , RT_VALUE* table , char* key )
     
     if ( ( table != NULL ) && ( table->type == RVT_TABLE ) )
     {
-        item = dmap_query( table->data , key );
+        item = fmap_query( table->data , key );
         
         if ( item != NULL )
         {
@@ -312,10 +372,7 @@ SLINT slext_tbl_get_int( SLRUNTIME runtime , RT_VALUE* table , char* key )
                 item = read_data( runtime , item->fpos );
             }
             
-            if ( ( item->type == RVT_STRING ) && ( item->data != NULL ) )
-            {
-                return atoi( item->data );
-            }
+            return slext_value_int( item );
         }
     }
     
@@ -332,7 +389,7 @@ char* slext_tbl_get_ptr(
     
     if ( ( table != NULL ) && ( table->type == RVT_TABLE ) )
     {
-        item = dmap_query( table->data , key );
+        item = fmap_query( table->data , key );
         
         if ( item != NULL )
         {
@@ -341,7 +398,7 @@ char* slext_tbl_get_ptr(
                 item = read_data( runtime , item->fpos );
             }
             
-            if ( ( item->type == RVT_STRING ) && ( item->data != NULL ) )
+            if ( value_cstr( item ) != NULL )
             {
                 if ( outsize )
                 {
@@ -367,7 +424,7 @@ RT_VALUE* slext_tbl_get_tbl( SLRUNTIME runtime , RT_VALUE* table , char* key )
     
     if ( ( table != NULL ) && ( table->type == RVT_TABLE ) )
     {
-        item = dmap_query( table->data , key );
+        item = fmap_query( table->data , key );
         
         if ( item != NULL )
         {
@@ -396,14 +453,14 @@ SLINT slext_tbl_set_int(
     
     if ( ( table != NULL ) && ( table->type == RVT_TABLE ) )
     {
-        item = dmap_getanddel( table->data , key );
+        item = fmap_getanddel( table->data , key );
         
         if ( item != NULL )
         {
             unref_value( runtime , item );
         }
         
-        dmap_insert( table->data , key , ref_value_int( runtime , value ) );
+        fmap_insert( table->data , key , ref_value_int( runtime , value ) );
         return 1;
     }
     
@@ -422,14 +479,19 @@ SLINT slext_tbl_set_ptr(
     
     if ( ( table != NULL ) && ( table->type == RVT_TABLE ) )
     {
-        item = dmap_getanddel( table->data , key );
+        item = fmap_getanddel( table->data , key );
         
         if ( item != NULL )
         {
             unref_value( runtime , item );
         }
         
-        dmap_insert(
+        if ( ! bcopy )
+        {
+            memadopt( str , MEMCAT_VALUE );
+        }
+        
+        fmap_insert(
             table->data ,
             key ,
             ref_value_str( runtime , str , size , bcopy )
@@ -450,14 +512,14 @@ SLINT slext_tbl_set_tbl(
     
     if ( ( table != NULL ) && ( table->type == RVT_TABLE ) )
     {
-        item = dmap_getanddel( table->data , key );
+        item = fmap_getanddel( table->data , key );
         
         if ( item != NULL )
         {
             unref_value( runtime , item );
         }
         
-        dmap_insert( table->data , key , ref_value( runtime , pvalue ) );
+        fmap_insert( table->data , key , ref_value( runtime , pvalue ) );
         return 1;
     }
     
@@ -474,14 +536,14 @@ SLINT slext_tbl_set_val(
     
     if ( ( table != NULL ) && ( table->type == RVT_TABLE ) )
     {
-        item = dmap_getanddel( table->data , key );
+        item = fmap_getanddel( table->data , key );
         
         if ( item != NULL )
         {
             unref_value( runtime , item );
         }
         
-        dmap_insert( table->data , key , ref_value( runtime , pvalue ) );
+        fmap_insert( table->data , key , ref_value( runtime , pvalue ) );
         return 1;
     }
     
@@ -531,7 +593,7 @@ SLINT slext_tbl_foreach(
         callback_param.runtime = runtime;
         callback_param.callback = callback;
         callback_param.param = param;
-        dmap_foreach(
+        fmap_foreach(
             table->data ,
             slext_tbl_foreach_callback ,
             &callback_param
@@ -544,13 +606,14 @@ SLINT slext_tbl_foreach(
 
 SLINT slext_val_get_type( RT_VALUE* svalue )
 {
+    if ( value_cstr( svalue ) != NULL )
+    {
+        return SLVALUE_TYPE_STR;
+    }
+    
     if ( ( svalue != NULL ) && ( svalue->data != NULL ) )
     {
-        if ( svalue->type == RVT_STRING )
-        {
-            return SLVALUE_TYPE_STR;
-        }
-        else if ( svalue->type == RVT_TABLE )
+        if ( svalue->type == RVT_TABLE )
         {
             return SLVALUE_TYPE_TBL;
         }
@@ -561,15 +624,7 @@ SLINT slext_val_get_type( RT_VALUE* svalue )
 
 SLINT slext_val_get_int( RT_VALUE* svalue )
 {
-    if ( ( svalue != NULL ) && ( svalue->data != NULL ) )
-    {
-        if ( svalue->type == RVT_STRING )
-        {
-            return atoi( svalue->data );
-        }
-    }
-    
-    return 0;
+    return slext_value_int( svalue );
 }
 
 char* slext_val_get_ptr( RT_VALUE* svalue , SLINT* outsize )
@@ -579,13 +634,14 @@ char* slext_val_get_ptr( RT_VALUE* svalue , SLINT* outsize )
         *outsize = 0;
     }
     
-    if ( ( svalue != NULL ) && ( svalue->data != NULL ) )
+    if ( value_cstr( svalue ) != NULL )
     {
-        if ( svalue->type == RVT_STRING )
+        if ( outsize )
         {
             *outsize = svalue->size;
-            return svalue->data;
         }
+        
+        return svalue->data;
     }
     
     return NULL;
@@ -636,11 +692,7 @@ SLINT slext_reg_func( MODULE* module , char* func_name , EXTFUNC func )
         node = node->next;
     }
     
-    strncpy(
-        node->name ,
-        func_name ,
-        MIN( MAX_WORD_NAME_LEN - 1 , strlen( func_name ) )
-    );
+    node->name = intern_name( func_name , -1 );
     node->extfunc = func;
     node->type = NT_EXTNODE;
     return 1;
@@ -688,7 +740,10 @@ EXTLIB_FUNC g_extlib_func = {
     slext_val_get_tbl ,
     
     slext_reg_func ,
-    slext_free_str
+    slext_free_str ,
+    
+    slext_get_double ,
+    slext_set_double
 };
 
 SLINT slext_load_module( MODULE* module , char* file_path )
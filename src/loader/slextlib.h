@@ -43,7 +43,7 @@ extern "C"
 #define SLVALUE_TYPE_NUL    0
 #define SLVALUE_TYPE_STR    1
 #define SLVALUE_TYPE_TBL    2
-
+
 #define SLCHARSET_ASCII     0
 #define SLCHARSET_UTF8      1
 
@@ -177,6 +177,14 @@ typedef SLINT   (* SLEXT_REG_FUNC)(
 
 typedef void    (* SLEXT_FREE_STR)( SLRUNTIME runtime , char* str );
 
+typedef double  (* SLEXT_GET_DOUBLE)( SLRUNTIME runtime , SLINT i );
+
+typedef SLINT   (* SLEXT_SET_DOUBLE)(
+    SLRUNTIME   runtime ,
+    SLINT       i       ,
+    double      value
+);
+
 typedef struct _EXTLIB_FUNC {
     SLEXT_GET_COUNT         slext_get_count;
     SLEXT_GET_INT           slext_get_int;
@@ -210,6 +218,10 @@ typedef struct _EXTLIB_FUNC {
 
     SLEXT_REG_FUNC          slext_reg_func;
     SLEXT_FREE_STR          slext_free_str;
+
+    /* appended so modules built against the older table keep working */
+    SLEXT_GET_DOUBLE        slext_get_double;
+    SLEXT_SET_DOUBLE        slext_set_double;
 }
 EXTLIB_FUNC;
 
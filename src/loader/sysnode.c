@@ -184,12 +184,7 @@ int sysnode_fission( RUNTIME* runtime )
     
     memcpy( node , runtime->current.node , sizeof( NODE ) );
     node->next = NULL;
-    memset( node->name , 0 , MAX_WORD_NAME_LEN );
-    strncpy(
-        node->name ,
-        nodename ,
-        MIN( nodenamesize , MAX_WORD_NAME_LEN - 1 )
-    );
+    node->name = intern_name( nodename , nodenamesize );
     node->type = NT_FISSIONNODE;
     node->param = memalloc_zero( sizeof( NODE_PARAM ) );
     node->param->count = runtime->current.node->param->count;
@@ -202,13 +197,11 @@ int sysnode_fission( RUNTIME* runtime )
         
         for ( i = 0; i < node->param->count; i++ )
         {
-            strcpy(
-                node->param->list[i].name ,
-                runtime->current.node->param->list[i].name
-            );
+            node->param->list[i].name =
+                runtime->current.node->param->list[i].name;
             node->param->list[i].value = ref_value(
                 runtime ,
-                runtime->current.node->param->list[i].value
+                PARAM_VALUE( runtime->caller.param , i )
             );
         }
     }
@@ -218,6 +211,114 @@ int sysnode_fission( RUNTIME* runtime )
         dmap_insert( runtime->current.module->nodemap , node->name , node );
     }
     
+    runtime->node_generation++;
+    
+    return RET_OK;
+}
+
+/* hits , misses , entries of the expression cache */
+int sysnode_evalstats( RUNTIME* runtime )
+{
+    EVAL_CACHE* cache = runtime->eval_cache;
+    INT64       stats[3];
+    int         i;
+    
+    stats[0] = cache->hits;
+    stats[1] = cache->misses;
+    stats[2] = cache->count;
+    
+    for ( i = 0; ( i < 3 ) && ( i < runtime->current.retvalue_count ); i++ )
+    {
+        unref_value( runtime , runtime->current.retvalue[i].value );
+        runtime->current.retvalue[i].value = ref_value_int64(
+            runtime ,
+            stats[i]
+        );
+    }
+    
+    return RET_OK;
+}
+
+static void memstats_item(
+    RUNTIME*    runtime ,
+    RT_VALUE*   table   ,
+    char*       key     ,
+    INT64       value
+) {
+    fmap_insert( table->data , key , ref_value_int64( runtime , value ) );
+}
+
+/*
+live , peak , the limits and <category>_count , <category>_bytes , all of
+this runtime
+*/
+int sysnode_memstats( RUNTIME* runtime )
+{
+    MEM_STATS*  stats = runtime->mem;
+    RT_VALUE*   table;
+    char        key[32];
+    int         i;
+    
+    if ( runtime->current.retvalue_count < 1 )
+    {
+        return RET_OK;
+    }
+    
+    table = new_table_value( runtime );
+    memstats_item( runtime , table , "live" , stats->live );
+    memstats_item( runtime , table , "peak" , stats->peak );
+    memstats_item( runtime , table , "soft" , runtime->mem_soft_limit );
+    memstats_item( runtime , table , "hard" , runtime->mem_hard_limit );
+    
+    for ( i = 0; i < MEMCAT_COUNT; i++ )
+    {
+        snprintf( key , 32 , "%s_count" , memstats_category_name( i ) );
+        memstats_item( runtime , table , key , stats->count[i] );
+        snprintf( key , 32 , "%s_bytes" , memstats_category_name( i ) );
+        memstats_item( runtime , table , key , stats->bytes[i] );
+    }
+    
+    unref_value( runtime , runtime->current.retvalue[0].value );
+    runtime->current.retvalue[0].value = table;
+    return RET_OK;
+}
+
+/* collect every cycle now, returns the tables freed */
+int sysnode_gc( RUNTIME* runtime )
+{
+    SLINT   freed;
+    
+    freed = gc_collect( runtime , 0 );
+    
+    if ( runtime->current.retvalue_count > 0 )
+    {
+        unref_value( runtime , runtime->current.retvalue[0].value );
+        runtime->current.retvalue[0].value = ref_value_int64( runtime , freed );
+    }
+    
+    return RET_OK;
+}
+
+/* cycles found , tables freed , bytes reclaimed by the collector */
+int sysnode_gcstats( RUNTIME* runtime )
+{
+    GC_STATE*   gc = runtime->gc;
+    INT64       stats[3];
+    int         i;
+    
+    stats[0] = gc->cycles;
+    stats[1] = gc->tables;
+    stats[2] = gc->bytes;
+    
+    for ( i = 0; ( i < 3 ) && ( i < runtime->current.retvalue_count ); i++ )
+    {
+        unref_value( runtime , runtime->current.retvalue[i].value );
+        runtime->current.retvalue[i].value = ref_value_int64(
+            runtime ,
+            stats[i]
+        );
+    }
+    
     return RET_OK;
 }
 
@@ -226,6 +327,7 @@ int sysnode_print( RUNTIME* runtime )
     int     i;
     int     n;
     char*   tmpstr;
+    SLINT   size;
     
     n = g_extlib_func.slext_get_count( runtime );
     
@@ -233,11 +335,12 @@ int sysnode_print( RUNTIME* runtime )
     {
         for ( i = 0; i < n; i++ )
         {
-            tmpstr = g_extlib_func.slext_get_ptr( runtime , i , NULL );
+            tmpstr = g_extlib_func.slext_get_ptr( runtime , i , &size );
             
+            /* by size, a zero byte does not end the value */
             if ( tmpstr )
             {
-                printf( "%s" , tmpstr );
+                fwrite( tmpstr , 1 , size , stdout );
             }
         }
     }
@@ -248,18 +351,25 @@ int sysnode_print( RUNTIME* runtime )
 
 typedef int (* SYSLIBNODE )( RUNTIME* runtime );
 
+EXTFUNC get_sys_node( RUNTIME* runtime , char* node_name )
+{
+    if ( runtime->sysnode )
+    {
+        return ( EXTFUNC )dmap_query( runtime->sysnode , node_name );
+    }
+    
+    return NULL;
+}
+
 int call_sys_node( RUNTIME* runtime , char* node_name )
 {
     SYSLIBNODE  node;
     
-    if ( runtime->sysnode )
+    node = ( SYSLIBNODE )get_sys_node( runtime , node_name );
+    
+    if ( node )
     {
-        node = ( SYSLIBNODE )dmap_query( runtime->sysnode , node_name );
-        
-        if ( node )
-        {
-            return node( runtime );
-        }
+        return node( runtime );
     }
     
     return RET_NO_NODE;
@@ -276,6 +386,10 @@ HDMAP init_sysnode_map()
     dmap_insert( hmap , ".fission" , sysnode_fission );
     dmap_insert( hmap , ".getchar" , sysnode_getchar );
     dmap_insert( hmap , ".print" , sysnode_print);
+    dmap_insert( hmap , ".evalstats" , sysnode_evalstats );
+    dmap_insert( hmap , ".memstats" , sysnode_memstats );
+    dmap_insert( hmap , ".gc" , sysnode_gc );
+    dmap_insert( hmap , ".gcstats" , sysnode_gcstats );
     
     return hmap;
 }
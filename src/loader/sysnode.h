@@ -19,6 +19,8 @@
 
 HDMAP init_sysnode_map();
 
+EXTFUNC get_sys_node( RUNTIME* runtime , char* node_name );
+
 int call_sys_node( RUNTIME* runtime , char* node_name );
 
 #endif
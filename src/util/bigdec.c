@@ -0,0 +1,833 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#include "bigdec.h"
+
+#include <string.h>
+#include <stdio.h>
+
+static const UINT32 g_pow10[BIGDEC_BASE_DIGITS] = {
+    1 , 10 , 100 , 1000 , 10000 , 100000 , 1000000 , 10000000 , 100000000
+};
+
+/* limbs of num * 10^d, produced from the least significant one up */
+typedef struct _LIMB_GEN    LIMB_GEN;
+
+struct _LIMB_GEN
+{
+    const BIGDEC*   num;
+    int             shift;  /* whole limbs of 10^d */
+    UINT32          mul;    /* what is left of 10^d */
+    UINT64          carry;
+    int             count;  /* limbs it yields */
+};
+
+static void limb_gen_init( LIMB_GEN* gen , const BIGDEC* num , int d )
+{
+    gen->num = num;
+    gen->shift = d / BIGDEC_BASE_DIGITS;
+    gen->mul = g_pow10[ d % BIGDEC_BASE_DIGITS ];
+    gen->carry = 0;
+    gen->count = num->count + gen->shift + ( ( gen->mul > 1 ) ? 1 : 0 );
+}
+
+/* call with k = 0 , 1 , 2 ... */
+static UINT32 limb_gen_next( LIMB_GEN* gen , int k )
+{
+    UINT64  v;
+    int     i;
+    
+    i = k - gen->shift;
+    
+    if ( i < 0 )
+    {
+        return 0;
+    }
+    
+    v = gen->carry;
+    
+    if ( i < gen->num->count )
+    {
+        v += ( UINT64 )gen->num->limb[i] * gen->mul;
+    }
+    
+    gen->carry = v / BIGDEC_BASE;
+    return ( UINT32 )( v % BIGDEC_BASE );
+}
+
+static void bigdec_trim( BIGDEC* num )
+{
+    while ( ( num->count > 0 ) && ( num->limb[ num->count - 1 ] == 0 ) )
+    {
+        num->count--;
+    }
+    
+    if ( num->count == 0 )
+    {
+        num->sign = 0;
+    }
+}
+
+void bigdec_init( BIGDEC* num , UINT32* limb , int size )
+{
+    num->limb = limb;
+    num->count = 0;
+    num->size = size;
+    num->scale = 0;
+    num->sign = 0;
+}
+
+static int is_digit( char c )
+{
+    return ( ( c >= '0' ) && ( c <= '9' ) );
+}
+
+static BOOL bigdec_scan(
+    const char*     str     ,
+    const char**    digits  ,
+    int*            intlen  ,
+    int*            fraclen ,
+    int*            sign
+) {
+    int     n;
+    int     f;
+    
+    while ( ( *str == ' ' ) || ( *str == '\t' )
+        || ( *str == '\r' ) || ( *str == '\n' ) )
+    {
+        str++;
+    }
+    
+    *sign = 0;
+    
+    if ( *str == '-' )
+    {
+        *sign = 1;
+        str++;
+    }
+    
+    n = 0;
+    
+    while ( is_digit( str[n] ) )
+    {
+        n++;
+    }
+    
+    *digits = str;
+    *intlen = n;
+    *fraclen = 0;
+    
+    if ( str[n] == '.' )
+    {
+        f = 0;
+        
+        while ( is_digit( str[ n + 1 + f ] ) )
+        {
+            f++;
+        }
+        
+        *fraclen = f;
+        n += 1 + f;
+    }
+    
+    return ( ( str[n] == 0 ) && ( *intlen + *fraclen > 0 ) );
+}
+
+int bigdec_parse_size( const char* str )
+{
+    const char* digits;
+    int         intlen;
+    int         fraclen;
+    int         sign;
+    
+    if ( ( str == NULL )
+        || ! bigdec_scan( str , &digits , &intlen , &fraclen , &sign ) )
+    {
+        return -1;
+    }
+    
+    return ( intlen + fraclen + BIGDEC_BASE_DIGITS - 1 ) / BIGDEC_BASE_DIGITS;
+}
+
+BOOL bigdec_parse( BIGDEC* num , const char* str )
+{
+    const char* digits;
+    int         intlen;
+    int         fraclen;
+    int         sign;
+    int         p;
+    int         k;
+    UINT32      limb;
+    UINT32      mul;
+    
+    if ( ( str == NULL )
+        || ! bigdec_scan( str , &digits , &intlen , &fraclen , &sign ) )
+    {
+        return FALSE;
+    }
+    
+    if ( ( intlen + fraclen + BIGDEC_BASE_DIGITS - 1 ) / BIGDEC_BASE_DIGITS
+        > num->size )
+    {
+        return FALSE;
+    }
+    
+    limb = 0;
+    mul = 1;
+    k = 0;
+    
+    /* right to left, skipping the decimal point */
+    for ( p = intlen + fraclen - 1; p >= 0; p-- )
+    {
+        limb += ( digits[ ( p < intlen ) ? p : p + 1 ] - '0' ) * mul;
+        mul *= 10;
+        
+        if ( mul == BIGDEC_BASE )
+        {
+            num->limb[k++] = limb;
+            limb = 0;
+            mul = 1;
+        }
+    }
+    
+    if ( mul > 1 )
+    {
+        num->limb[k++] = limb;
+    }
+    
+    num->count = k;
+    num->scale = fraclen;
+    num->sign = sign;
+    bigdec_trim( num );
+    return TRUE;
+}
+
+void bigdec_set_int( BIGDEC* num , INT64 value )
+{
+    UINT64  v;
+    
+    num->sign = ( value < 0 );
+    v = num->sign ? ( UINT64 )0 - ( UINT64 )value : ( UINT64 )value;
+    num->count = 0;
+    num->scale = 0;
+    
+    while ( ( v > 0 ) && ( num->count < num->size ) )
+    {
+        num->limb[ num->count++ ] = ( UINT32 )( v % BIGDEC_BASE );
+        v /= BIGDEC_BASE;
+    }
+    
+    bigdec_trim( num );
+}
+
+BOOL bigdec_is_zero( const BIGDEC* num )
+{
+    return ( num->count == 0 );
+}
+
+int bigdec_format_size( const BIGDEC* num )
+{
+    /* sign, leading "0", point and terminator */
+    return num->count * BIGDEC_BASE_DIGITS + num->scale + 4;
+}
+
+int bigdec_format( const BIGDEC* num , char* buf , int size )
+{
+    char*   p;
+    int     n;
+    int     i;
+    int     pad;
+    
+    if ( size < bigdec_format_size( num ) )
+    {
+        return -1;
+    }
+    
+    p = buf;
+    
+    if ( num->sign && ( num->count > 0 ) )
+    {
+        *p++ = '-';
+    }
+    
+    if ( num->count == 0 )
+    {
+        p[0] = '0';
+        p[1] = 0;
+        n = 1;
+    }
+    else
+    {
+        n = sprintf( p , "%u" , num->limb[ num->count - 1 ] );
+        
+        for ( i = num->count - 2; i >= 0; i-- )
+        {
+            n += sprintf( p + n , "%09u" , num->limb[i] );
+        }
+    }
+    
+    if ( num->scale > 0 )
+    {
+        /* at least one digit before the point */
+        if ( n <= num->scale )
+        {
+            pad = num->scale + 1 - n;
+            memmove( p + pad , p , n + 1 );
+            memset( p , '0' , pad );
+            n += pad;
+        }
+        
+        memmove( p + n - num->scale + 1 , p + n - num->scale , num->scale + 1 );
+        p[ n - num->scale ] = '.';
+        n++;
+    }
+    
+    return ( int )( p - buf ) + n;
+}
+
+static int bigdec_cmp_abs( const BIGDEC* a , const BIGDEC* b )
+{
+    LIMB_GEN    ga;
+    LIMB_GEN    gb;
+    UINT32      x;
+    UINT32      y;
+    int         scale;
+    int         n;
+    int         k;
+    int         ret;
+    
+    scale = MAX( a->scale , b->scale );
+    limb_gen_init( &ga , a , scale - a->scale );
+    limb_gen_init( &gb , b , scale - b->scale );
+    n = MAX( ga.count , gb.count );
+    ret = 0;
+    
+    /* the last difference seen is the most significant one */
+    for ( k = 0; k < n; k++ )
+    {
+        x = limb_gen_next( &ga , k );
+        y = limb_gen_next( &gb , k );
+        
+        if ( x != y )
+        {
+            ret = ( x < y ) ? -1 : 1;
+        }
+    }
+    
+    return ret;
+}
+
+int bigdec_cmp( const BIGDEC* a , const BIGDEC* b )
+{
+    int     ret;
+    
+    if ( a->sign != b->sign )
+    {
+        return a->sign ? -1 : 1;
+    }
+    
+    ret = bigdec_cmp_abs( a , b );
+    return a->sign ? -ret : ret;
+}
+
+static int bigdec_scaled_count( const BIGDEC* num , int d )
+{
+    return num->count + d / BIGDEC_BASE_DIGITS + 1;
+}
+
+int bigdec_add_size( const BIGDEC* a , const BIGDEC* b )
+{
+    int     scale;
+    
+    scale = MAX( a->scale , b->scale );
+    
+    return MAX(
+        bigdec_scaled_count( a , scale - a->scale ) ,
+        bigdec_scaled_count( b , scale - b->scale )
+    ) + 1;
+}
+
+/* r = a + b with b taken as having sign bsign */
+static BOOL bigdec_add_signed(
+    BIGDEC*         r       ,
+    const BIGDEC*   a       ,
+    const BIGDEC*   b       ,
+    int             bsign
+) {
+    LIMB_GEN    ga;
+    LIMB_GEN    gb;
+    INT64       s;
+    UINT32      carry;
+    int         scale;
+    int         n;
+    int         k;
+    
+    scale = MAX( a->scale , b->scale );
+    limb_gen_init( &ga , a , scale - a->scale );
+    limb_gen_init( &gb , b , scale - b->scale );
+    n = MAX( ga.count , gb.count );
+    
+    if ( r->size < n + 1 )
+    {
+        return FALSE;
+    }
+    
+    r->scale = scale;
+    r->sign = a->sign;
+    carry = 0;
+    
+    if ( a->sign == bsign )
+    {
+        for ( k = 0; k < n; k++ )
+        {
+            s = ( INT64 )limb_gen_next( &ga , k )
+                + limb_gen_next( &gb , k ) + carry;
+            carry = ( s >= BIGDEC_BASE );
+            r->limb[k] = ( UINT32 )( carry ? s - BIGDEC_BASE : s );
+        }
+        
+        r->limb[n] = carry;
+        r->count = n + 1;
+    }
+    else
+    {
+        for ( k = 0; k < n; k++ )
+        {
+            s = ( INT64 )limb_gen_next( &ga , k )
+                - limb_gen_next( &gb , k ) - carry;
+            carry = ( s < 0 );
+            r->limb[k] = ( UINT32 )( carry ? s + BIGDEC_BASE : s );
+        }
+        
+        r->count = n;
+        
+        if ( carry )
+        {
+            /* |b| > |a|, take the complement */
+            carry = 0;
+            
+            for ( k = 0; k < n; k++ )
+            {
+                s = - ( INT64 )r->limb[k] - carry;
+                carry = ( s < 0 );
+                r->limb[k] = ( UINT32 )( carry ? s + BIGDEC_BASE : s );
+            }
+            
+            r->sign = bsign;
+        }
+    }
+    
+    bigdec_trim( r );
+    return TRUE;
+}
+
+BOOL bigdec_add( BIGDEC* r , const BIGDEC* a , const BIGDEC* b )
+{
+    return bigdec_add_signed( r , a , b , b->sign );
+}
+
+BOOL bigdec_sub( BIGDEC* r , const BIGDEC* a , const BIGDEC* b )
+{
+    return bigdec_add_signed( r , a , b , ( b->count > 0 ) && ! b->sign );
+}
+
+/* r[0..nr) += a[0..na), na <= nr, return the carry out */
+static UINT32 limb_add_to( UINT32* r , int nr , const UINT32* a , int na )
+{
+    UINT32  carry;
+    UINT32  s;
+    int     i;
+    
+    carry = 0;
+    
+    for ( i = 0; ( i < nr ) && ( ( i < na ) || carry ); i++ )
+    {
+        s = r[i] + ( ( i < na ) ? a[i] : 0 ) + carry;
+        carry = ( s >= BIGDEC_BASE );
+        r[i] = carry ? s - BIGDEC_BASE : s;
+    }
+    
+    return carry;
+}
+
+/* r[0..nr) -= a[0..na), the caller knows r >= a */
+static void limb_sub_from( UINT32* r , int nr , const UINT32* a , int na )
+{
+    INT64   s;
+    UINT32  borrow;
+    int     i;
+    
+    borrow = 0;
+    
+    for ( i = 0; ( i < nr ) && ( ( i < na ) || borrow ); i++ )
+    {
+        s = ( INT64 )r[i] - ( ( i < na ) ? a[i] : 0 ) - borrow;
+        borrow = ( s < 0 );
+        r[i] = ( UINT32 )( borrow ? s + BIGDEC_BASE : s );
+    }
+}
+
+/* r[0..na+nb) = a * b */
+static void limb_mul_school(
+    UINT32*         r   ,
+    const UINT32*   a   ,
+    int             na  ,
+    const UINT32*   b   ,
+    int             nb
+) {
+    UINT64  t;
+    UINT64  carry;
+    int     i;
+    int     j;
+    
+    memset( r , 0 , sizeof( UINT32 ) * ( na + nb ) );
+    
+    for ( i = 0; i < na; i++ )
+    {
+        if ( a[i] == 0 )
+        {
+            continue;
+        }
+        
+        carry = 0;
+        
+        for ( j = 0; j < nb; j++ )
+        {
+            t = ( UINT64 )a[i] * b[j] + r[ i + j ] + carry;
+            r[ i + j ] = ( UINT32 )( t % BIGDEC_BASE );
+            carry = t / BIGDEC_BASE;
+        }
+        
+        r[ i + nb ] = ( UINT32 )carry;
+    }
+}
+
+static int limb_mul_scratch( int n )
+{
+    int     h;
+    
+    if ( n < BIGDEC_KARATSUBA_CUTOFF )
+    {
+        return 0;
+    }
+    
+    h = ( n + 1 ) / 2;
+    return 4 * ( h + 1 ) + limb_mul_scratch( h + 1 );
+}
+
+/*
+r[0..na+nb) = a * b, karatsuba while both halves of the shorter operand
+are worth splitting, schoolbook below BIGDEC_KARATSUBA_CUTOFF
+*/
+static void limb_mul(
+    UINT32*         r       ,
+    const UINT32*   a       ,
+    int             na      ,
+    const UINT32*   b       ,
+    int             nb      ,
+    UINT32*         scratch
+) {
+    const UINT32*   t;
+    UINT32*         sa;
+    UINT32*         sb;
+    UINT32*         z1;
+    int             h;
+    int             nz;
+    
+    if ( na < nb )
+    {
+        t = a;
+        a = b;
+        b = t;
+        h = na;
+        na = nb;
+        nb = h;
+    }
+    
+    h = ( na + 1 ) / 2;
+    
+    if ( ( nb < BIGDEC_KARATSUBA_CUTOFF ) || ( nb <= h ) )
+    {
+        limb_mul_school( r , a , na , b , nb );
+        return;
+    }
+    
+    /* z0 = a0 * b0 and z2 = a1 * b1 straight into r */
+    limb_mul( r , a , h , b , h , scratch );
+    limb_mul( r + 2 * h , a + h , na - h , b + h , nb - h , scratch );
+    
+    /* z1 = ( a0 + a1 ) * ( b0 + b1 ) - z0 - z2 */
+    sa = scratch;
+    sb = sa + h + 1;
+    z1 = sb + h + 1;
+    
+    memcpy( sa , a , sizeof( UINT32 ) * h );
+    sa[h] = limb_add_to( sa , h , a + h , na - h );
+    memcpy( sb , b , sizeof( UINT32 ) * h );
+    sb[h] = limb_add_to( sb , h , b + h , nb - h );
+    
+    limb_mul( z1 , sa , h + 1 , sb , h + 1 , z1 + 2 * h + 2 );
+    limb_sub_from( z1 , 2 * h + 2 , r , 2 * h );
+    limb_sub_from( z1 , 2 * h + 2 , r + 2 * h , na + nb - 2 * h );
+    
+    nz = 2 * h + 2;
+    
+    while ( ( nz > 0 ) && ( z1[ nz - 1 ] == 0 ) )
+    {
+        nz--;
+    }
+    
+    limb_add_to( r + h , na + nb - h , z1 , nz );
+}
+
+int bigdec_mul_size( const BIGDEC* a , const BIGDEC* b )
+{
+    return MAX( a->count + b->count , 1 );
+}
+
+int bigdec_mul_scratch( const BIGDEC* a , const BIGDEC* b )
+{
+    return limb_mul_scratch( MAX( a->count , b->count ) );
+}
+
+BOOL bigdec_mul( BIGDEC* r , const BIGDEC* a , const BIGDEC* b , UINT32* scratch )
+{
+    r->scale = a->scale + b->scale;
+    r->sign = a->sign ^ b->sign;
+    
+    if ( ( a->count == 0 ) || ( b->count == 0 ) )
+    {
+        r->count = 0;
+        r->sign = 0;
+        return TRUE;
+    }
+    
+    if ( r->size < a->count + b->count )
+    {
+        return FALSE;
+    }
+    
+    limb_mul( r->limb , a->limb , a->count , b->limb , b->count , scratch );
+    r->count = a->count + b->count;
+    bigdec_trim( r );
+    return TRUE;
+}
+
+/* dst = num * 10^d, return the limb count */
+static int limb_scale( UINT32* dst , const BIGDEC* num , int d )
+{
+    LIMB_GEN    gen;
+    int         k;
+    
+    limb_gen_init( &gen , num , d );
+    
+    for ( k = 0; k < gen.count; k++ )
+    {
+        dst[k] = limb_gen_next( &gen , k );
+    }
+    
+    while ( ( k > 0 ) && ( dst[ k - 1 ] == 0 ) )
+    {
+        k--;
+    }
+    
+    return k;
+}
+
+/*
+q[0..nu-nv] = u / v with nv >= 2, knuth's algorithm D in base 10^9,
+u needs room for nu + 1 limbs and both are overwritten
+*/
+static void limb_div( UINT32* q , UINT32* u , int nu , UINT32* v , int nv )
+{
+    UINT32  d;
+    UINT64  t;
+    UINT64  num;
+    UINT64  qhat;
+    UINT64  rhat;
+    UINT64  carry;
+    INT64   s;
+    UINT32  borrow;
+    int     i;
+    int     j;
+    
+    /* normalize so the top divisor limb is at least BASE / 2 */
+    d = BIGDEC_BASE / ( v[ nv - 1 ] + 1 );
+    carry = 0;
+    
+    for ( i = 0; i < nu; i++ )
+    {
+        t = ( UINT64 )u[i] * d + carry;
+        u[i] = ( UINT32 )( t % BIGDEC_BASE );
+        carry = t / BIGDEC_BASE;
+    }
+    
+    u[nu] = ( UINT32 )carry;
+    carry = 0;
+    
+    for ( i = 0; i < nv; i++ )
+    {
+        t = ( UINT64 )v[i] * d + carry;
+        v[i] = ( UINT32 )( t % BIGDEC_BASE );
+        carry = t / BIGDEC_BASE;
+    }
+    
+    for ( j = nu - nv; j >= 0; j-- )
+    {
+        num = ( UINT64 )u[ j + nv ] * BIGDEC_BASE + u[ j + nv - 1 ];
+        qhat = num / v[ nv - 1 ];
+        rhat = num % v[ nv - 1 ];
+        
+        while ( ( qhat >= BIGDEC_BASE )
+            || ( qhat * v[ nv - 2 ]
+                > rhat * BIGDEC_BASE + u[ j + nv - 2 ] ) )
+        {
+            qhat--;
+            rhat += v[ nv - 1 ];
+            
+            if ( rhat >= BIGDEC_BASE )
+            {
+                break;
+            }
+        }
+        
+        /* u[j..j+nv] -= qhat * v */
+        carry = 0;
+        borrow = 0;
+        
+        for ( i = 0; i < nv; i++ )
+        {
+            t = qhat * v[i] + carry;
+            carry = t / BIGDEC_BASE;
+            s = ( INT64 )u[ i + j ] - ( INT64 )( t % BIGDEC_BASE ) - borrow;
+            borrow = ( s < 0 );
+            u[ i + j ] = ( UINT32 )( borrow ? s + BIGDEC_BASE : s );
+        }
+        
+        s = ( INT64 )u[ j + nv ] - ( INT64 )carry - borrow;
+        
+        if ( s < 0 )
+        {
+            /* qhat was one too large, add v back */
+            u[ j + nv ] = ( UINT32 )( s + BIGDEC_BASE );
+            qhat--;
+            carry = 0;
+            
+            for ( i = 0; i < nv; i++ )
+            {
+                t = ( UINT64 )u[ i + j ] + v[i] + carry;
+                u[ i + j ] = ( UINT32 )( t % BIGDEC_BASE );
+                carry = t / BIGDEC_BASE;
+            }
+            
+            u[ j + nv ] = ( UINT32 )( ( u[ j + nv ] + carry ) % BIGDEC_BASE );
+        }
+        else
+        {
+            u[ j + nv ] = ( UINT32 )s;
+        }
+        
+        q[j] = ( UINT32 )qhat;
+    }
+}
+
+static int bigdec_div_shift( const BIGDEC* a , const BIGDEC* b , int scale )
+{
+    return scale + b->scale - a->scale;
+}
+
+int bigdec_div_size( const BIGDEC* a , const BIGDEC* b , int scale )
+{
+    int     e;
+    
+    e = bigdec_div_shift( a , b , scale );
+    return MAX( bigdec_scaled_count( a , MAX( e , 0 ) ) , 1 );
+}
+
+int bigdec_div_scratch( const BIGDEC* a , const BIGDEC* b , int scale )
+{
+    int     e;
+    
+    e = bigdec_div_shift( a , b , scale );
+    
+    return bigdec_scaled_count( a , MAX( e , 0 ) ) + 1
+        + bigdec_scaled_count( b , MAX( -e , 0 ) );
+}
+
+BOOL bigdec_div(
+    BIGDEC*         r       ,
+    const BIGDEC*   a       ,
+    const BIGDEC*   b       ,
+    int             scale   ,
+    UINT32*         scratch
+) {
+    UINT32* u;
+    UINT32* v;
+    UINT64  rem;
+    UINT64  t;
+    int     nu;
+    int     nv;
+    int     e;
+    int     i;
+    
+    if ( b->count == 0 )
+    {
+        return FALSE;
+    }
+    
+    /* a / b at scale s is the integer a * 10^e / b */
+    e = bigdec_div_shift( a , b , scale );
+    u = scratch;
+    v = scratch + bigdec_scaled_count( a , MAX( e , 0 ) ) + 1;
+    nu = limb_scale( u , a , MAX( e , 0 ) );
+    nv = limb_scale( v , b , MAX( -e , 0 ) );
+    
+    r->scale = scale;
+    r->sign = a->sign ^ b->sign;
+    
+    if ( nu < nv )
+    {
+        r->count = 0;
+        r->sign = 0;
+        return TRUE;
+    }
+    
+    if ( r->size < nu - nv + 1 )
+    {
+        return FALSE;
+    }
+    
+    if ( nv == 1 )
+    {
+        rem = 0;
+        
+        for ( i = nu - 1; i >= 0; i-- )
+        {
+            t = rem * BIGDEC_BASE + u[i];
+            r->limb[i] = ( UINT32 )( t / v[0] );
+            rem = t % v[0];
+        }
+        
+        r->count = nu;
+    }
+    else
+    {
+        limb_div( r->limb , u , nu , v , nv );
+        r->count = nu - nv + 1;
+    }
+    
+    bigdec_trim( r );
+    return TRUE;
+}
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#ifndef __UTIL_BIGDEC_H_INCLUDED__
+#define __UTIL_BIGDEC_H_INCLUDED__
+
+#include "stypes.h"
+
+/*
+arbitrary precision decimal, value = limbs * 10^-scale
+
+limbs are base 10^9, least significant first, and live in a buffer the
+caller owns; every operation takes the limb counts it needs from the
+matching *_size function and returns FALSE when the buffer is too small.
+results must not share their buffer with an operand.
+*/
+
+#define BIGDEC_BASE                 1000000000
+#define BIGDEC_BASE_DIGITS          9
+
+/* limb count below which multiplication stays schoolbook */
+#define BIGDEC_KARATSUBA_CUTOFF     32
+
+typedef struct _BIGDEC      BIGDEC;
+
+struct _BIGDEC
+{
+    UINT32*     limb;
+    int         count;  /* limbs in use, 0 for zero */
+    int         size;   /* limbs in the buffer */
+    int         scale;  /* digits after the decimal point */
+    int         sign;   /* 1 for negative */
+};
+
+void bigdec_init( BIGDEC* num , UINT32* limb , int size );
+
+/* limbs needed to parse str, -1 when str is not a decimal number */
+int bigdec_parse_size( const char* str );
+
+/* [spaces][-]digits[.digits] */
+BOOL bigdec_parse( BIGDEC* num , const char* str );
+
+void bigdec_set_int( BIGDEC* num , INT64 value );
+
+BOOL bigdec_is_zero( const BIGDEC* num );
+
+/* bytes needed for the text, terminator included */
+int bigdec_format_size( const BIGDEC* num );
+
+/* return the text length, -1 when buf is too small */
+int bigdec_format( const BIGDEC* num , char* buf , int size );
+
+/* -1, 0, 1 as a < b, a == b, a > b */
+int bigdec_cmp( const BIGDEC* a , const BIGDEC* b );
+
+/* sum and difference keep the larger scale */
+int bigdec_add_size( const BIGDEC* a , const BIGDEC* b );
+
+BOOL bigdec_add( BIGDEC* r , const BIGDEC* a , const BIGDEC* b );
+
+BOOL bigdec_sub( BIGDEC* r , const BIGDEC* a , const BIGDEC* b );
+
+/* the product scale is the sum of the operand scales */
+int bigdec_mul_size( const BIGDEC* a , const BIGDEC* b );
+
+int bigdec_mul_scratch( const BIGDEC* a , const BIGDEC* b );
+
+BOOL bigdec_mul( BIGDEC* r , const BIGDEC* a , const BIGDEC* b , UINT32* scratch );
+
+/* quotient truncated toward zero at the given scale */
+int bigdec_div_size( const BIGDEC* a , const BIGDEC* b , int scale );
+
+int bigdec_div_scratch( const BIGDEC* a , const BIGDEC* b , int scale );
+
+/* FALSE for a zero divisor */
+BOOL bigdec_div(
+    BIGDEC*         r       ,
+    const BIGDEC*   a       ,
+    const BIGDEC*   b       ,
+    int             scale   ,
+    UINT32*         scratch
+);
+
+#endif
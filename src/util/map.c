@@ -16,12 +16,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 
 #include "logger.h"
 #include "map.h"
 #include "memalloc.h"
 
+/* smallest bucket count a rebuild leaves */
+#define DMAP_MIN_SIZE       8
+
 unsigned long gethash( const char* key )
 {
     unsigned long   hash;
@@ -32,7 +34,7 @@ unsigned long gethash( const char* key )
     
     while ( (* key ) && ( i > 0 ) )
     {
-        hash = ( hash << i ) + hash + toupper( *key++ );
+        hash = hash * 31 + ( unsigned char )*key++;
         i--;
     }
     
@@ -69,7 +71,11 @@ char* dmap_insert64( HDMAP hmap , char* key , long long data )
         return NULL;
     }
     
-    if ( hmap->nodecount > ( hmap->hashsize * 10 ) )
+    /*
+    grow past 2 nodes per bucket and shrink below 1 in 8, a rebuild leaves
+    1 in 2, so neither one follows right after the other
+    */
+    if ( hmap->nodecount > ( hmap->hashsize * 2 ) )
     {
         dmap_rebuild( hmap );
     }
@@ -227,7 +233,8 @@ void dmap_erase( HDMAP hmap , char* key )
             hmap->nodecount--;
             memfree( node );
             
-            if ( ( hmap->nodecount * 100 ) < hmap->hashsize )
+            if ( ( hmap->hashsize > DMAP_MIN_SIZE * 8 )
+                && ( ( hmap->nodecount * 8 ) < hmap->hashsize ) )
             {
                 dmap_rebuild( hmap );
             }
@@ -327,6 +334,36 @@ int dmap_foreach2( HDMAP hmap , DMAP_CALLBACK2 callback , void* param )
     return 1;
 }
 
+void dmap_iter_init( HDMAP hmap , DMAP_ITER* iter )
+{
+    iter->index = 0;
+    iter->node = NULL;
+}
+
+int dmap_iter_next( HDMAP hmap , DMAP_ITER* iter , char** key , void** data )
+{
+    HDMAP_NODE  node;
+    
+    node = iter->node;
+    
+    while ( node == NULL )
+    {
+        if ( iter->index >= hmap->hashsize )
+        {
+            return 0;
+        }
+        
+        node = hmap->node[iter->index];
+        iter->index++;
+    }
+    
+    /* the next node is taken now, so the caller may erase this one */
+    iter->node = node->next;
+    *key = node->key;
+    *data = ( void* )node->data;
+    return 1;
+}
+
 int dmap_getcount( HDMAP hmap )
 {
     return hmap->nodecount;
@@ -342,6 +379,11 @@ void dmap_rebuild( HDMAP hmap )
     HDMAP_NODE*     newnodelist;
     
     newhashsize = hmap->nodecount * 2;
+    
+    if ( newhashsize < DMAP_MIN_SIZE )
+    {
+        newhashsize = DMAP_MIN_SIZE;
+    }
     newnodelist = memalloc_zero( sizeof( HDMAP_NODE ) * newhashsize );
     
     for ( i = 0; i < hmap->hashsize; i++ )
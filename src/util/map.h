@@ -44,6 +44,14 @@ struct _DMAP_ROOT
 
 unsigned long gethash( const char* key );
 
+typedef struct _DMAP_ITER   DMAP_ITER;
+
+struct _DMAP_ITER
+{
+    int         index;
+    DMAP_NODE*  node;   /* next node to visit */
+};
+
 /* return continue? */
 typedef int (* DMAP_CALLBACK )( char* key , void* data , void* param );
 
@@ -70,6 +78,11 @@ int dmap_foreach( HDMAP hmap , DMAP_CALLBACK callback , void* param );
 
 int dmap_foreach2( HDMAP hmap , DMAP_CALLBACK2 callback , void* param );
 
+void dmap_iter_init( HDMAP hmap , DMAP_ITER* iter );
+
+/* return 0 when there are no more items */
+int dmap_iter_next( HDMAP hmap , DMAP_ITER* iter , char** key , void** data );
+
 int dmap_getcount( HDMAP hmap );
 
 void dmap_rebuild( HDMAP hmap );
@@ -0,0 +1,1097 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#define MEMALLOC_CATEGORY   MEMCAT_TABLE
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __SSE2__ )
+    #include <emmintrin.h>
+#endif
+
+#include "logger.h"
+#include "map_flat.h"
+#include "memalloc.h"
+
+#define FMAP_EMPTY          ( ( signed char )-128 )
+#define FMAP_DELETED        ( ( signed char )-2 )
+
+#define FMAP_H1( hash )     ( ( unsigned int )( ( hash ) >> 7 ) )
+#define FMAP_H2( hash )     ( ( signed char )( ( hash ) & 0x7F ) )
+
+/* at most 7/8 of the slots are ever filled */
+#define FMAP_MAX_LOAD( n )  ( ( n ) - ( n ) / 8 )
+
+static unsigned long long fmap_mix( unsigned long long h )
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+unsigned long long fmap_hash( const char* key , unsigned int len )
+{
+    unsigned long long  h;
+    unsigned long long  w;
+    
+    h = 0x9E3779B97F4A7C15ULL ^ len;
+    
+    while ( len >= 8 )
+    {
+        memcpy( &w , key , 8 );
+        h = ( h ^ fmap_mix( w ) ) * 0x9E3779B97F4A7C15ULL;
+        key += 8;
+        len -= 8;
+    }
+    
+    if ( len > 0 )
+    {
+        w = 0;
+        memcpy( &w , key , len );
+        h = ( h ^ fmap_mix( w ) ) * 0x9E3779B97F4A7C15ULL;
+    }
+    
+    return fmap_mix( h );
+}
+
+static unsigned int fmap_lowbit( unsigned int bits )
+{
+#if defined( __GNUC__ )
+    return __builtin_ctz( bits );
+#else
+    unsigned int i = 0;
+    
+    while ( ( bits & 1 ) == 0 )
+    {
+        bits >>= 1;
+        i++;
+    }
+    
+    return i;
+#endif
+}
+
+/* bit i is set when ctrl[i] == c */
+static unsigned int fmap_match( const signed char* ctrl , signed char c )
+{
+#if defined( __SSE2__ )
+    __m128i group = _mm_loadu_si128( ( const __m128i* )ctrl );
+    return _mm_movemask_epi8( _mm_cmpeq_epi8( group , _mm_set1_epi8( c ) ) );
+#else
+    unsigned int    bits = 0;
+    int             i;
+    
+    for ( i = 0; i < FMAP_GROUP; i++ )
+    {
+        if ( ctrl[i] == c )
+        {
+            bits |= 1u << i;
+        }
+    }
+    
+    return bits;
+#endif
+}
+
+/* bit i is set when ctrl[i] is empty or deleted */
+static unsigned int fmap_match_free( const signed char* ctrl )
+{
+#if defined( __SSE2__ )
+    return _mm_movemask_epi8( _mm_loadu_si128( ( const __m128i* )ctrl ) );
+#else
+    unsigned int    bits = 0;
+    int             i;
+    
+    for ( i = 0; i < FMAP_GROUP; i++ )
+    {
+        if ( ctrl[i] < 0 )
+        {
+            bits |= 1u << i;
+        }
+    }
+    
+    return bits;
+#endif
+}
+
+/* the first group is mirrored past the end so a probe never wraps */
+static void fmap_set_ctrl( FMAP_TABLE* table , unsigned int i , signed char c )
+{
+    table->ctrl[i] = c;
+    
+    if ( i < FMAP_GROUP )
+    {
+        table->ctrl[ table->capacity + i ] = c;
+    }
+}
+
+static long fmap_find(
+    FMAP_TABLE*         table   ,
+    const char*         arena   ,
+    const char*         key     ,
+    unsigned int        len     ,
+    unsigned long long  hash
+) {
+    unsigned int    mask;
+    unsigned int    pos;
+    unsigned int    step = 0;
+    unsigned int    bits;
+    unsigned int    i;
+    signed char     h2 = FMAP_H2( hash );
+    FMAP_SLOT*      slot;
+    
+    if ( table->capacity == 0 )
+    {
+        return -1;
+    }
+    
+    mask = table->capacity - 1;
+    pos = FMAP_H1( hash ) & mask;
+    
+    while ( 1 )
+    {
+        bits = fmap_match( table->ctrl + pos , h2 );
+        
+        while ( bits )
+        {
+            i = ( pos + fmap_lowbit( bits ) ) & mask;
+            slot = &table->slot[i];
+            
+            if ( ( slot->hash == hash )
+                && ( slot->keylen == len )
+                && ( memcmp( arena + slot->key , key , len ) == 0 ) )
+            {
+                return i;
+            }
+            
+            bits &= bits - 1;
+        }
+        
+        if ( fmap_match( table->ctrl + pos , FMAP_EMPTY ) )
+        {
+            return -1;
+        }
+        
+        step += FMAP_GROUP;
+        pos = ( pos + step ) & mask;
+    }
+}
+
+static unsigned int fmap_find_free( FMAP_TABLE* table , unsigned long long hash )
+{
+    unsigned int    mask = table->capacity - 1;
+    unsigned int    pos = FMAP_H1( hash ) & mask;
+    unsigned int    step = 0;
+    unsigned int    bits;
+    
+    while ( 1 )
+    {
+        bits = fmap_match_free( table->ctrl + pos );
+        
+        if ( bits )
+        {
+            return ( pos + fmap_lowbit( bits ) ) & mask;
+        }
+        
+        step += FMAP_GROUP;
+        pos = ( pos + step ) & mask;
+    }
+}
+
+static void fmap_table_alloc( FMAP_TABLE* table , unsigned int capacity )
+{
+    table->capacity = capacity;
+    table->growth = FMAP_MAX_LOAD( capacity );
+    table->ctrl = memalloc( capacity + FMAP_GROUP );
+    memset( table->ctrl , FMAP_EMPTY , capacity + FMAP_GROUP );
+    table->slot = memalloc( sizeof( FMAP_SLOT ) * capacity );
+}
+
+static void fmap_table_free( FMAP_TABLE* table )
+{
+    memfree( table->ctrl );
+    memfree( table->slot );
+    memset( table , 0 , sizeof( FMAP_TABLE ) );
+}
+
+static unsigned int fmap_place( FMAP_TABLE* table , FMAP_SLOT* slot )
+{
+    unsigned int    i;
+    
+    i = fmap_find_free( table , slot->hash );
+    
+    if ( ( table->ctrl[i] == FMAP_EMPTY ) && ( table->growth > 0 ) )
+    {
+        table->growth--;
+    }
+    
+    table->slot[i] = *slot;
+    fmap_set_ctrl( table , i , FMAP_H2( slot->hash ) );
+    return i;
+}
+
+/* move up to budget slots of the old table, then drop it once empty */
+static void fmap_migrate( HFMAP hmap , unsigned int budget )
+{
+    FMAP_TABLE*     old = &hmap->old;
+    unsigned int    i;
+    
+    if ( old->capacity == 0 )
+    {
+        return;
+    }
+    
+    while ( ( hmap->migrate < old->capacity ) && ( budget > 0 ) )
+    {
+        i = hmap->migrate++;
+        budget--;
+        
+        /* a tombstone keeps the probe chains of the slots still to move */
+        if ( old->ctrl[i] >= 0 )
+        {
+            fmap_place( &hmap->table , &old->slot[i] );
+            fmap_set_ctrl( old , i , FMAP_DELETED );
+        }
+    }
+    
+    if ( hmap->migrate >= old->capacity )
+    {
+        fmap_table_free( old );
+        hmap->migrate = 0;
+    }
+}
+
+/*
+the new table is allocated now and filled a few slots per operation, it is
+sized so the keys still to come fit before the old one runs out
+*/
+static void fmap_resize( HFMAP hmap , unsigned int capacity )
+{
+    fmap_migrate( hmap , ( unsigned int )-1 );
+    hmap->old = hmap->table;
+    hmap->migrate = 0;
+    fmap_table_alloc( &hmap->table , capacity );
+    
+    if ( hmap->old.capacity == 0 )
+    {
+        return;
+    }
+    
+    fmap_migrate( hmap , FMAP_MIGRATE );
+}
+
+/*
+grow at 7/8 full and shrink below 1/16, a resized table ends up 7/16 full
+at most, so filling and emptying around one size does not resize each time
+*/
+static void fmap_check_size( HFMAP hmap , int adding )
+{
+    unsigned int    capacity = hmap->table.capacity;
+    unsigned int    target;
+    
+    if ( hmap->old.capacity != 0 )
+    {
+        return;
+    }
+    
+    if ( capacity == 0 )
+    {
+        if ( adding )
+        {
+            fmap_table_alloc( &hmap->table , FMAP_GROUP );
+        }
+        
+        return;
+    }
+    
+    if ( adding && ( hmap->table.growth == 0 ) )
+    {
+        /* tombstones alone filled it, so it is rebuilt at the same size */
+        if ( hmap->count > FMAP_MAX_LOAD( capacity ) / 2 )
+        {
+            capacity *= 2;
+        }
+        
+        fmap_resize( hmap , capacity );
+    }
+    else if ( ( capacity > FMAP_GROUP ) && ( hmap->count < capacity / 16 ) )
+    {
+        target = FMAP_GROUP;
+        
+        while ( FMAP_MAX_LOAD( target ) / 4 < hmap->count )
+        {
+            target *= 2;
+        }
+        
+        /* not below what the old table can still send over in time */
+        if ( target < capacity / 32 )
+        {
+            target = capacity / 32;
+        }
+        
+        fmap_resize( hmap , target );
+    }
+}
+
+/* make room for need more bytes, dropping erased keys on the way */
+static void fmap_arena_reserve( HFMAP hmap , unsigned int need )
+{
+    char*           arena;
+    unsigned int    size;
+    unsigned int    used = 0;
+    unsigned int    i;
+    unsigned int    k;
+    FMAP_TABLE*     table;
+    FMAP_SLOT*      slot;
+    
+    if ( hmap->arena_used + need <= hmap->arena_size )
+    {
+        return;
+    }
+    
+    /* a walk still refers to keys by offset, erased ones included */
+    if ( hmap->iterators > 0 )
+    {
+        size = ( hmap->arena_used + need ) * 2;
+        arena = memalloc( size );
+        memcpy( arena , hmap->arena , hmap->arena_used );
+        memfree( hmap->arena );
+        hmap->arena = arena;
+        hmap->arena_size = size;
+        return;
+    }
+    
+    size = ( hmap->arena_used - hmap->arena_dead + need ) * 2;
+    
+    if ( size < 64 )
+    {
+        size = 64;
+    }
+    
+    arena = memalloc( size );
+    
+    for ( k = 0; k < 2; k++ )
+    {
+        table = ( k == 0 ) ? &hmap->table : &hmap->old;
+        
+        for ( i = 0; i < table->capacity; i++ )
+        {
+            if ( table->ctrl[i] >= 0 )
+            {
+                slot = &table->slot[i];
+                memcpy( arena + used , hmap->arena + slot->key , slot->keylen + 1 );
+                slot->key = used;
+                used += slot->keylen + 1;
+            }
+        }
+    }
+    
+    memfree( hmap->arena );
+    hmap->arena = arena;
+    hmap->arena_size = size;
+    hmap->arena_used = used;
+    hmap->arena_dead = 0;
+}
+
+HFMAP fmap_init( int size )
+{
+    HFMAP           hmap;
+    unsigned int    capacity;
+    
+    hmap = memalloc_zero( sizeof( FMAP_ROOT ) );
+    
+    if ( size > 0 )
+    {
+        capacity = FMAP_GROUP;
+        
+        while ( FMAP_MAX_LOAD( capacity ) < ( unsigned int )size )
+        {
+            capacity *= 2;
+        }
+        
+        fmap_table_alloc( &hmap->table , capacity );
+    }
+    
+    return hmap;
+}
+
+char* fmap_insert( HFMAP hmap , char* key , void* data )
+{
+    return fmap_insert64_len( hmap , key , strlen( key ) , ( long long )data );
+}
+
+char* fmap_insert_len( HFMAP hmap , char* key , unsigned int len , void* data )
+{
+    return fmap_insert64_len( hmap , key , len , ( long long )data );
+}
+
+/* the slot holding key in either table, or NULL */
+static FMAP_SLOT* fmap_lookup(
+    HFMAP           hmap    ,
+    const char*     key     ,
+    unsigned int    len     ,
+    FMAP_TABLE**    owner
+) {
+    unsigned long long  hash;
+    long                i;
+    
+    hash = fmap_hash( key , len );
+    i = fmap_find( &hmap->table , hmap->arena , key , len , hash );
+    
+    if ( i >= 0 )
+    {
+        *owner = &hmap->table;
+        return &hmap->table.slot[i];
+    }
+    
+    i = fmap_find( &hmap->old , hmap->arena , key , len , hash );
+    
+    if ( i >= 0 )
+    {
+        *owner = &hmap->old;
+        return &hmap->old.slot[i];
+    }
+    
+    return NULL;
+}
+
+static char* fmap_hash_insert(
+    HFMAP           hmap    ,
+    char*           key     ,
+    unsigned int    len     ,
+    long long       data
+) {
+    FMAP_TABLE*     owner;
+    FMAP_SLOT*      found;
+    FMAP_SLOT       slot;
+    char*           copy = NULL;
+    unsigned int    i;
+    
+    fmap_migrate( hmap , FMAP_MIGRATE );
+    found = fmap_lookup( hmap , key , len , &owner );
+    
+    if ( found != NULL )
+    {
+        found->data = data;
+        return hmap->arena + found->key;
+    }
+    
+    fmap_check_size( hmap , 1 );
+    
+    /* a key read back from this map moves with the arena */
+    if ( ( key >= hmap->arena ) && ( key < hmap->arena + hmap->arena_size ) )
+    {
+        copy = memalloc( len );
+        memcpy( copy , key , len );
+        key = copy;
+    }
+    
+    fmap_arena_reserve( hmap , len + 1 );
+    
+    slot.hash = fmap_hash( key , len );
+    slot.key = hmap->arena_used;
+    slot.keylen = len;
+    slot.data = data;
+    memcpy( hmap->arena + slot.key , key , len );
+    hmap->arena[ slot.key + len ] = 0;
+    hmap->arena_used += len + 1;
+    i = fmap_place( &hmap->table , &slot );
+    hmap->count++;
+    
+    if ( copy != NULL )
+    {
+        memfree( copy );
+    }
+    
+    return hmap->arena + hmap->table.slot[i].key;
+}
+
+/* return 1 and the data when the hash part held the key */
+static int fmap_hash_take(
+    HFMAP           hmap    ,
+    char*           key     ,
+    unsigned int    len     ,
+    long long*      data
+) {
+    FMAP_TABLE*     owner;
+    FMAP_SLOT*      found;
+    
+    fmap_migrate( hmap , FMAP_MIGRATE );
+    found = fmap_lookup( hmap , key , len , &owner );
+    
+    if ( found == NULL )
+    {
+        return 0;
+    }
+    
+    /* the key bytes stay until the arena is compacted */
+    *data = found->data;
+    fmap_set_ctrl( owner , found - owner->slot , FMAP_DELETED );
+    hmap->arena_dead += found->keylen + 1;
+    hmap->count--;
+    
+    /* a table emptied by erases gives its slots back without an insert */
+    fmap_check_size( hmap , 0 );
+    return 1;
+}
+
+/* n when key is the canonical text of 1 <= n <= FMAP_ARRAY_MAX, else 0 */
+static unsigned int fmap_array_key( const char* key , unsigned int len )
+{
+    unsigned long long  n = 0;
+    unsigned int        i;
+    
+    if ( ( len == 0 ) || ( len > 10 ) || ( key[0] < '1' ) || ( key[0] > '9' ) )
+    {
+        return 0;
+    }
+    
+    for ( i = 0; i < len; i++ )
+    {
+        if ( ( key[i] < '0' ) || ( key[i] > '9' ) )
+        {
+            return 0;
+        }
+        
+        n = n * 10 + ( key[i] - '0' );
+    }
+    
+    return ( n <= FMAP_ARRAY_MAX ) ? ( unsigned int )n : 0;
+}
+
+static unsigned int fmap_array_text( char* buf , unsigned int n )
+{
+    char            tmp[12];
+    unsigned int    len = 0;
+    unsigned int    i;
+    
+    do
+    {
+        tmp[len++] = '0' + n % 10;
+        n /= 10;
+    }
+    while ( n > 0 );
+    
+    for ( i = 0; i < len; i++ )
+    {
+        buf[i] = tmp[ len - 1 - i ];
+    }
+    
+    buf[len] = 0;
+    return len;
+}
+
+static void fmap_array_push( HFMAP hmap , long long data )
+{
+    long long*      array;
+    
+    if ( hmap->array_used == hmap->array_size )
+    {
+        hmap->array_size = ( hmap->array_size == 0 ) ? 4 : hmap->array_size * 2;
+        array = memalloc( sizeof( long long ) * hmap->array_size );
+        
+        if ( hmap->array_used > 0 )
+        {
+            memcpy( array , hmap->array , sizeof( long long ) * hmap->array_used );
+        }
+        
+        memfree( hmap->array );
+        hmap->array = array;
+    }
+    
+    hmap->array[ hmap->array_used++ ] = data;
+    hmap->array_count++;
+}
+
+/* append the key after the array part, then the keys the hash part holds */
+static void fmap_array_append( HFMAP hmap , long long data )
+{
+    char            key[12];
+    unsigned int    len;
+    
+    fmap_array_push( hmap , data );
+    
+    while ( ( hmap->count > 0 ) && ( hmap->array_used < FMAP_ARRAY_MAX ) )
+    {
+        len = fmap_array_text( key , hmap->array_used + 1 );
+        
+        if ( ! fmap_hash_take( hmap , key , len , &data ) )
+        {
+            break;
+        }
+        
+        fmap_array_push( hmap , data );
+    }
+}
+
+char* fmap_insert64( HFMAP hmap , char* key , long long data )
+{
+    return fmap_insert64_len( hmap , key , strlen( key ) , data );
+}
+
+char* fmap_insert64_len(
+    HFMAP           hmap    ,
+    char*           key     ,
+    unsigned int    len     ,
+    long long       data
+) {
+    unsigned int    n;
+    
+    if ( hmap == NULL )
+    {
+        return NULL;
+    }
+    
+    n = fmap_array_key( key , len );
+    
+    if ( ( n > 0 ) && ( n <= hmap->array_used ) )
+    {
+        if ( hmap->array[ n - 1 ] == FMAP_HOLE )
+        {
+            hmap->array_count++;
+        }
+        
+        hmap->array[ n - 1 ] = data;
+    }
+    else if ( ( n > 0 ) && ( n == hmap->array_used + 1 ) )
+    {
+        fmap_array_append( hmap , data );
+    }
+    else
+    {
+        return fmap_hash_insert( hmap , key , len , data );
+    }
+    
+    fmap_array_text( hmap->keybuf , n );
+    return hmap->keybuf;
+}
+
+void* fmap_query( HFMAP hmap , char* key )
+{
+    return ( void* )fmap_query64_len( hmap , key , strlen( key ) );
+}
+
+void* fmap_query_len( HFMAP hmap , char* key , unsigned int len )
+{
+    return ( void* )fmap_query64_len( hmap , key , len );
+}
+
+long long fmap_query64( HFMAP hmap , char* key )
+{
+    return fmap_query64_len( hmap , key , strlen( key ) );
+}
+
+long long fmap_query64_len( HFMAP hmap , char* key , unsigned int len )
+{
+    unsigned int    n;
+    FMAP_TABLE*     owner;
+    FMAP_SLOT*      found;
+    
+    if ( hmap == NULL )
+    {
+        return ( long long )NULL;
+    }
+    
+    n = fmap_array_key( key , len );
+    
+    if ( ( n > 0 ) && ( n <= hmap->array_used ) )
+    {
+        if ( hmap->array[ n - 1 ] == FMAP_HOLE )
+        {
+            return ( long long )NULL;
+        }
+        
+        return hmap->array[ n - 1 ];
+    }
+    
+    found = fmap_lookup( hmap , key , len , &owner );
+    
+    if ( found == NULL )
+    {
+        return ( long long )NULL;
+    }
+    
+    return found->data;
+}
+
+void* fmap_getanddel( HFMAP hmap , char* key )
+{
+    return fmap_getanddel_len( hmap , key , strlen( key ) );
+}
+
+void* fmap_getanddel_len( HFMAP hmap , char* key , unsigned int len )
+{
+    unsigned int    n;
+    long long       data;
+    
+    if ( hmap == NULL )
+    {
+        return NULL;
+    }
+    
+    n = fmap_array_key( key , len );
+    
+    if ( ( n > 0 ) && ( n <= hmap->array_used ) )
+    {
+        data = hmap->array[ n - 1 ];
+        
+        if ( data == FMAP_HOLE )
+        {
+            return NULL;
+        }
+        
+        hmap->array[ n - 1 ] = FMAP_HOLE;
+        hmap->array_count--;
+        
+        /* a key past the end goes back to the hash part when set again */
+        while ( ( hmap->array_used > 0 )
+            && ( hmap->array[ hmap->array_used - 1 ] == FMAP_HOLE ) )
+        {
+            hmap->array_used--;
+        }
+        
+        return ( void* )data;
+    }
+    
+    if ( ! fmap_hash_take( hmap , key , len , &data ) )
+    {
+        return NULL;
+    }
+    
+    return ( void* )data;
+}
+
+void fmap_erase( HFMAP hmap , char* key )
+{
+    fmap_getanddel_len( hmap , key , strlen( key ) );
+}
+
+void fmap_erase_len( HFMAP hmap , char* key , unsigned int len )
+{
+    fmap_getanddel_len( hmap , key , len );
+}
+
+void fmap_release( HFMAP hmap , FMAP_CALLBACK callback , void* param )
+{
+    unsigned int    i;
+    unsigned int    k;
+    char            key[12];
+    FMAP_TABLE*     table;
+    
+    if ( hmap == NULL )
+    {
+        return;
+    }
+    
+    if ( callback != NULL )
+    {
+        for ( i = 0; i < hmap->array_used; i++ )
+        {
+            if ( hmap->array[i] != FMAP_HOLE )
+            {
+                fmap_array_text( key , i + 1 );
+                callback( key , ( void* )hmap->array[i] , param );
+            }
+        }
+        
+        for ( k = 0; k < 2; k++ )
+        {
+            table = ( k == 0 ) ? &hmap->table : &hmap->old;
+            
+            for ( i = 0; i < table->capacity; i++ )
+            {
+                if ( table->ctrl[i] >= 0 )
+                {
+                    callback(
+                        hmap->arena + table->slot[i].key ,
+                        ( void* )table->slot[i].data ,
+                        param
+                    );
+                }
+            }
+        }
+    }
+    
+    fmap_table_free( &hmap->table );
+    fmap_table_free( &hmap->old );
+    memfree( hmap->arena );
+    memfree( hmap->array );
+    memfree( hmap );
+}
+
+int fmap_foreach( HFMAP hmap , FMAP_CALLBACK callback , void* param )
+{
+    unsigned int    i;
+    char            key[12];
+    
+    if ( callback == NULL )
+    {
+        return 0;
+    }
+    
+    fmap_migrate( hmap , ( unsigned int )-1 );
+    
+    for ( i = 0; i < hmap->array_used; i++ )
+    {
+        if ( hmap->array[i] != FMAP_HOLE )
+        {
+            fmap_array_text( key , i + 1 );
+            
+            if ( callback( key , ( void* )hmap->array[i] , param ) == 0 )
+            {
+                return 0;
+            }
+        }
+    }
+    
+    for ( i = 0; i < hmap->table.capacity; i++ )
+    {
+        if ( hmap->table.ctrl[i] >= 0 )
+        {
+            if ( callback(
+                    hmap->arena + hmap->table.slot[i].key ,
+                    ( void* )hmap->table.slot[i].data ,
+                    param ) == 0 )
+            {
+                return 0;
+            }
+        }
+    }
+    
+    return 1;
+}
+
+int fmap_foreach2( HFMAP hmap , FMAP_CALLBACK2 callback , void* param )
+{
+    unsigned int    i;
+    char            key[12];
+    
+    if ( callback == NULL )
+    {
+        return 0;
+    }
+    
+    fmap_migrate( hmap , ( unsigned int )-1 );
+    
+    for ( i = 0; i < hmap->array_used; i++ )
+    {
+        if ( hmap->array[i] != FMAP_HOLE )
+        {
+            fmap_array_text( key , i + 1 );
+            
+            if ( callback( key , ( void** )&hmap->array[i] , param ) == 0 )
+            {
+                return 0;
+            }
+        }
+    }
+    
+    for ( i = 0; i < hmap->table.capacity; i++ )
+    {
+        if ( hmap->table.ctrl[i] >= 0 )
+        {
+            if ( callback(
+                    hmap->arena + hmap->table.slot[i].key ,
+                    ( void** )&hmap->table.slot[i].data ,
+                    param ) == 0 )
+            {
+                return 0;
+            }
+        }
+    }
+    
+    return 1;
+}
+
+int fmap_foreach_len( HFMAP hmap , FMAP_CALLBACK_LEN callback , void* param )
+{
+    unsigned int    i;
+    unsigned int    len;
+    char            key[12];
+    
+    if ( callback == NULL )
+    {
+        return 0;
+    }
+    
+    fmap_migrate( hmap , ( unsigned int )-1 );
+    
+    for ( i = 0; i < hmap->array_used; i++ )
+    {
+        if ( hmap->array[i] != FMAP_HOLE )
+        {
+            len = fmap_array_text( key , i + 1 );
+            
+            if ( callback( key , len , ( void* )hmap->array[i] , param ) == 0 )
+            {
+                return 0;
+            }
+        }
+    }
+    
+    for ( i = 0; i < hmap->table.capacity; i++ )
+    {
+        if ( hmap->table.ctrl[i] >= 0 )
+        {
+            if ( callback(
+                    hmap->arena + hmap->table.slot[i].key ,
+                    hmap->table.slot[i].keylen ,
+                    ( void* )hmap->table.slot[i].data ,
+                    param ) == 0 )
+            {
+                return 0;
+            }
+        }
+    }
+    
+    return 1;
+}
+
+void fmap_iter_init( HFMAP hmap , FMAP_ITER* iter )
+{
+    unsigned int    i;
+    
+    fmap_migrate( hmap , ( unsigned int )-1 );
+    iter->array = 0;
+    iter->array_end = hmap->array_used;
+    iter->snap = NULL;
+    iter->count = 0;
+    iter->index = 0;
+    iter->live = 1;
+    hmap->iterators++;
+    
+    if ( hmap->count == 0 )
+    {
+        return;
+    }
+    
+    iter->snap = memalloc( sizeof( FMAP_KEYREF ) * hmap->count );
+    
+    for ( i = 0; i < hmap->table.capacity; i++ )
+    {
+        if ( hmap->table.ctrl[i] >= 0 )
+        {
+            iter->snap[ iter->count ].key = hmap->table.slot[i].key;
+            iter->snap[ iter->count ].keylen = hmap->table.slot[i].keylen;
+            iter->snap[ iter->count ].slot = i;
+            iter->count++;
+        }
+    }
+}
+
+/* the data of a listed key in either part, 0 when it is not there */
+static int fmap_iter_find( HFMAP hmap , FMAP_KEYREF* ref , long long* data )
+{
+    FMAP_TABLE*     owner;
+    FMAP_SLOT*      found;
+    char*           key = hmap->arena + ref->key;
+    unsigned int    n;
+    
+    /*
+    the arena is not compacted during a walk, so a live slot still holding
+    the same offset is the same key and needs no lookup
+    */
+    if ( ( ref->slot < hmap->table.capacity ) &&
+         ( hmap->table.ctrl[ ref->slot ] >= 0 ) &&
+         ( hmap->table.slot[ ref->slot ].key == ref->key ) )
+    {
+        *data = hmap->table.slot[ ref->slot ].data;
+        return 1;
+    }
+    
+    /* a key taken into the array part since the walk started */
+    n = fmap_array_key( key , ref->keylen );
+    
+    if ( ( n > 0 ) && ( n <= hmap->array_used ) )
+    {
+        *data = hmap->array[ n - 1 ];
+        return *data != FMAP_HOLE;
+    }
+    
+    found = fmap_lookup( hmap , key , ref->keylen , &owner );
+    
+    if ( found == NULL )
+    {
+        return 0;
+    }
+    
+    *data = found->data;
+    return 1;
+}
+
+int fmap_iter_next( HFMAP hmap , FMAP_ITER* iter , char** key , void** data )
+{
+    unsigned int    i;
+    long long       found;
+    FMAP_KEYREF*    ref;
+    
+    if ( ! iter->live )
+    {
+        return 0;
+    }
+    
+    /* later array items were added or taken from the listed keys */
+    for ( i = iter->array; ( i < iter->array_end ) && ( i < hmap->array_used ); i++ )
+    {
+        if ( hmap->array[i] != FMAP_HOLE )
+        {
+            iter->array = i + 1;
+            iter->keylen = fmap_array_text( iter->key , i + 1 );
+            *key = iter->key;
+            *data = ( void* )hmap->array[i];
+            return 1;
+        }
+    }
+    
+    iter->array = iter->array_end;
+    
+    while ( iter->index < iter->count )
+    {
+        ref = &iter->snap[ iter->index++ ];
+        
+        if ( fmap_iter_find( hmap , ref , &found ) )
+        {
+            iter->keylen = ref->keylen;
+            *key = hmap->arena + ref->key;
+            *data = ( void* )found;
+            return 1;
+        }
+    }
+    
+    fmap_iter_end( hmap , iter );
+    return 0;
+}
+
+void fmap_iter_end( HFMAP hmap , FMAP_ITER* iter )
+{
+    if ( ! iter->live )
+    {
+        return;
+    }
+    
+    memfree( iter->snap );
+    iter->snap = NULL;
+    iter->live = 0;
+    hmap->iterators--;
+}
+
+int fmap_getcount( HFMAP hmap )
+{
+    return hmap->count + hmap->array_count;
+}
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#ifndef __UTIL_MAP_FLAT_H_INCLUDED__
+#define __UTIL_MAP_FLAT_H_INCLUDED__
+
+#ifndef NULL
+    #define NULL            0
+#endif
+
+/* control bytes probed at a time */
+#define FMAP_GROUP          16
+
+/* largest key kept in the array part */
+#define FMAP_ARRAY_MAX      0x7FFFFFFF
+
+/* marks a missing key in the array part, never stored as data */
+#define FMAP_HOLE           ( -0x7FFFFFFFFFFFFFFFLL - 1 )
+
+/* slots of the old table moved on each insert or erase while resizing */
+#define FMAP_MIGRATE        64
+
+typedef struct _FMAP_SLOT   FMAP_SLOT;
+
+struct _FMAP_SLOT
+{
+    unsigned long long  hash;
+    unsigned int        key;        /* offset of the key in the arena */
+    unsigned int        keylen;
+    long long           data;
+};
+
+typedef struct _FMAP_TABLE  FMAP_TABLE;
+
+struct _FMAP_TABLE
+{
+    unsigned int        capacity;   /* power of two, 0 when not allocated */
+    unsigned int        growth;     /* empty slots that may still be filled */
+    signed char*        ctrl;       /* capacity + FMAP_GROUP bytes */
+    FMAP_SLOT*          slot;
+};
+
+typedef struct _FMAP_ROOT   FMAP_ROOT;
+typedef struct _FMAP_ROOT*  HFMAP;
+
+/*
+open addressing in the swiss table layout: one control byte per slot holds
+7 bits of the hash, or marks the slot empty or deleted, so a probe checks
+a whole group of slots before touching any of them
+
+a resize allocates the new table and leaves the old one in place, each
+later insert or erase moves a few of its slots over, lookups check both
+
+the keys "1" to "array_used" are never hashed, their data sits in a plain
+array that takes over the next key from the hash part each time it grows
+*/
+struct _FMAP_ROOT
+{
+    FMAP_TABLE          table;      /* new keys go here */
+    FMAP_TABLE          old;        /* being emptied into table */
+    unsigned int        migrate;    /* next slot of old to move */
+    unsigned int        count;      /* keys in the hash part */
+    char*               arena;      /* keys, each with its terminating zero */
+    unsigned int        arena_used;
+    unsigned int        arena_size;
+    unsigned int        arena_dead; /* bytes held by erased keys */
+    long long*          array;
+    unsigned int        array_used;
+    unsigned int        array_size;
+    unsigned int        array_count;    /* keys present in the array part */
+    unsigned int        iterators;      /* live ones, the arena is not */
+                                        /* compacted under them */
+    char                keybuf[12];     /* text of an array key handed out */
+};
+
+typedef struct _FMAP_ITER   FMAP_ITER;
+
+typedef struct _FMAP_KEYREF FMAP_KEYREF;
+
+struct _FMAP_KEYREF
+{
+    unsigned int        key;        /* offset of the key in the arena */
+    unsigned int        keylen;
+    unsigned int        slot;       /* where it was when the walk started */
+};
+
+/*
+the hashed keys are listed when the walk starts and looked up again one by
+one, so a resize or migration under it does not move its place
+*/
+struct _FMAP_ITER
+{
+    unsigned int        array;      /* next array item to look at */
+    unsigned int        array_end;  /* array_used when the walk started */
+    FMAP_KEYREF*        snap;
+    unsigned int        count;      /* keys in snap */
+    unsigned int        index;      /* then the next of them */
+    int                 live;
+    unsigned int        keylen;     /* of the key last returned */
+    char                key[12];
+};
+
+/* return continue? */
+typedef int (* FMAP_CALLBACK )( char* key , void* data , void* param );
+
+/* return continue? */
+typedef int (* FMAP_CALLBACK2 )( char* key , void** data , void* param );
+
+/* return continue? len counts zero bytes inside the key */
+typedef int (* FMAP_CALLBACK_LEN )(
+    char*           key     ,
+    unsigned int    len     ,
+    void*           data    ,
+    void*           param
+);
+
+unsigned long long fmap_hash( const char* key , unsigned int len );
+
+/* size is a hint of the number of keys, 0 allocates nothing yet */
+HFMAP fmap_init( int size );
+
+/*
+the returned key stays valid until the next insert, the _len forms take
+keys that may hold zero bytes, the others stop at the first one
+*/
+char* fmap_insert( HFMAP hmap , char* key , void* data );
+
+char* fmap_insert_len( HFMAP hmap , char* key , unsigned int len , void* data );
+
+char* fmap_insert64( HFMAP hmap , char* key , long long data );
+
+char* fmap_insert64_len(
+    HFMAP           hmap    ,
+    char*           key     ,
+    unsigned int    len     ,
+    long long       data
+);
+
+void* fmap_query( HFMAP hmap , char* key );
+
+void* fmap_query_len( HFMAP hmap , char* key , unsigned int len );
+
+long long fmap_query64( HFMAP hmap , char* key );
+
+long long fmap_query64_len( HFMAP hmap , char* key , unsigned int len );
+
+void* fmap_getanddel( HFMAP hmap , char* key );
+
+void* fmap_getanddel_len( HFMAP hmap , char* key , unsigned int len );
+
+void fmap_erase( HFMAP hmap , char* key );
+
+void fmap_erase_len( HFMAP hmap , char* key , unsigned int len );
+
+void fmap_release( HFMAP hmap , FMAP_CALLBACK callback , void* param );
+
+int fmap_foreach( HFMAP hmap , FMAP_CALLBACK callback , void* param );
+
+int fmap_foreach2( HFMAP hmap , FMAP_CALLBACK2 callback , void* param );
+
+int fmap_foreach_len( HFMAP hmap , FMAP_CALLBACK_LEN callback , void* param );
+
+/*
+each key present now is seen once unless it is erased before the walk gets
+to it, keys added while walking are not seen, the map may change meanwhile
+*/
+void fmap_iter_init( HFMAP hmap , FMAP_ITER* iter );
+
+/* return 0 when there are no more items, the walk is then ended */
+/* the array part comes first, in key order */
+int fmap_iter_next( HFMAP hmap , FMAP_ITER* iter , char** key , void** data );
+
+/* for a walk left before fmap_iter_next returned 0, ending twice is fine */
+void fmap_iter_end( HFMAP hmap , FMAP_ITER* iter );
+
+int fmap_getcount( HFMAP hmap );
+
+#endif
@@ -18,36 +18,92 @@
 #include "stypes.h"
 #include "memalloc.h"
 
-void* memalloc( long  size )
+#ifdef WINDOWS
+    #include <malloc.h>
+    #define MEM_BLOCK_SIZE( ptr )   _msize( ptr )
+#elif defined( __APPLE__ )
+    #include <malloc/malloc.h>
+    #define MEM_BLOCK_SIZE( ptr )   malloc_size( ptr )
+#else
+    #include <malloc.h>
+    #define MEM_BLOCK_SIZE( ptr )   malloc_usable_size( ptr )
+#endif
+
+static MEM_STATS g_memstats;
+static MEM_STATS* g_memcharge;
+
+static char* g_memcat_name[ MEMCAT_COUNT ] = {
+    "other" ,
+    "value" ,
+    "table" ,
+    "code" ,
+    "eval" ,
+    "dump"
+};
+
+static void memstats_add(
+    MEM_STATS*  stats       ,
+    long long   block       ,
+    long        size        ,
+    int         category
+) {
+    stats->live += block;
+    
+    if ( stats->live > stats->peak )
+    {
+        stats->peak = stats->live;
+    }
+    
+    stats->count[ category ]++;
+    stats->bytes[ category ] += size;
+}
+
+void* memalloc_cat( long size , int category )
 {
-    return malloc( size );
+    void*       ret;
+    long long   block;
+    
+    ret = malloc( size );
+    
+    if ( ret != NULL )
+    {
+        block = MEM_BLOCK_SIZE( ret );
+        memstats_add( &g_memstats , block , size , category );
+        
+        if ( g_memcharge != NULL )
+        {
+            memstats_add( g_memcharge , block , size , category );
+        }
+    }
+    
+    return ret;
 }
 
-void* memalloc_zero( long  size )
+void* memalloc_zero_cat( long size , int category )
 {
     void* ret;
     
-    ret = memalloc( size );
+    ret = memalloc_cat( size , category );
     memset( ret , 0 , size );
     return ret;
 }
 
-void* memclone( void* ptr , long size )
+void* memclone_cat( void* ptr , long size , int category )
 {
     void*   ptr2;
     
-    ptr2 = memalloc( size );
+    ptr2 = memalloc_cat( size , category );
     memcpy( ptr2 , ptr , size );
     return ptr2;
 }
 
-char* dup_str( const char* str )
+char* dup_str_cat( const char* str , int category )
 {
     char*   ret;
     int     n;
     
     n       = strlen( str );
-    ret     = memalloc( n + 1 );
+    ret     = memalloc_cat( n + 1 , category );
     strcpy( ret , str );
     ret[n]  = 0;
     return ret;
@@ -55,5 +111,172 @@ char* dup_str( const char* str )
 
 void memfree( void* ptr )
 {
-    free( ptr );
+    long long   block;
+    
+    if ( ptr != NULL )
+    {
+        block = MEM_BLOCK_SIZE( ptr );
+        g_memstats.live -= block;
+        
+        if ( g_memcharge != NULL )
+        {
+            g_memcharge->live -= block;
+        }
+        
+        free( ptr );
+    }
+}
+
+void memadopt( void* ptr , int category )
+{
+    long long   block;
+    
+    if ( ptr != NULL )
+    {
+        block = MEM_BLOCK_SIZE( ptr );
+        memstats_add( &g_memstats , block , block , category );
+        
+        if ( g_memcharge != NULL )
+        {
+            memstats_add( g_memcharge , block , block , category );
+        }
+    }
+}
+
+void memstats_get( MEM_STATS* stats )
+{
+    memcpy( stats , &g_memstats , sizeof( MEM_STATS ) );
+}
+
+long long memstats_live()
+{
+    return g_memstats.live;
+}
+
+MEM_STATS* memstats_charge( MEM_STATS* stats )
+{
+    MEM_STATS*  prev;
+    
+    prev = g_memcharge;
+    g_memcharge = stats;
+    return prev;
+}
+
+const char* memstats_category_name( int category )
+{
+    if ( ( category < 0 ) || ( category >= MEMCAT_COUNT ) )
+    {
+        return NULL;
+    }
+    
+    return g_memcat_name[ category ];
+}
+
+void mempool_init( MEM_POOL* pool , int category )
+{
+    memset( pool , 0 , sizeof( MEM_POOL ) );
+    pool->category = category;
+}
+
+#ifdef MEMPOOL_MALLOC
+
+void* mempool_alloc( MEM_POOL* pool , long size )
+{
+    return memalloc_cat( size , pool->category );
+}
+
+void mempool_free( MEM_POOL* pool , void* ptr , long size )
+{
+    memfree( ptr );
+}
+
+void mempool_release( MEM_POOL* pool )
+{
+}
+
+#else
+
+void* mempool_alloc( MEM_POOL* pool , long size )
+{
+    MEMPOOL_CLASS*  cls;
+    MEMPOOL_SLAB*   slab;
+    void*           ret;
+    long            block;
+    
+    if ( ( size <= 0 ) || ( size > MEMPOOL_ALIGN * MEMPOOL_CLASSES ) )
+    {
+        return memalloc_cat( size , pool->category );
+    }
+    
+    cls = &pool->cls[ ( size - 1 ) / MEMPOOL_ALIGN ];
+    
+    if ( cls->free != NULL )
+    {
+        ret = cls->free;
+        cls->free = *( void** )ret;
+        return ret;
+    }
+    
+    block = ( ( size - 1 ) / MEMPOOL_ALIGN + 1 ) * MEMPOOL_ALIGN;
+    
+    if ( cls->next + block > cls->end )
+    {
+        slab = memalloc_cat(
+            sizeof( MEMPOOL_SLAB ) + MEMPOOL_SLAB_SIZE ,
+            pool->category
+        );
+        slab->next = pool->slab;
+        pool->slab = slab;
+        cls->next = ( char* )( slab + 1 );
+        cls->end = cls->next + MEMPOOL_SLAB_SIZE;
+    }
+    
+    ret = cls->next;
+    cls->next += block;
+    return ret;
+}
+
+void mempool_free( MEM_POOL* pool , void* ptr , long size )
+{
+    MEMPOOL_CLASS*  cls;
+    
+    if ( ptr == NULL )
+    {
+        return;
+    }
+    
+    if ( ( size <= 0 ) || ( size > MEMPOOL_ALIGN * MEMPOOL_CLASSES ) )
+    {
+        memfree( ptr );
+        return;
+    }
+    
+    cls = &pool->cls[ ( size - 1 ) / MEMPOOL_ALIGN ];
+    *( void** )ptr = cls->free;
+    cls->free = ptr;
+}
+
+void mempool_release( MEM_POOL* pool )
+{
+    MEMPOOL_SLAB*   slab;
+    
+    while ( pool->slab != NULL )
+    {
+        slab = pool->slab;
+        pool->slab = slab->next;
+        memfree( slab );
+    }
+    
+    mempool_init( pool , pool->category );
+}
+
+#endif
+
+void* mempool_alloc_zero( MEM_POOL* pool , long size )
+{
+    void*   ret;
+    
+    ret = mempool_alloc( pool , size );
+    memset( ret , 0 , size );
+    return ret;
 }
@@ -16,14 +16,111 @@
 #ifndef __UTIL_MEMALLOC_H__INCLUDED__
 #define __UTIL_MEMALLOC_H__INCLUDED__
 
-void* memalloc( long  size );
+enum MEM_CATEGORY
+{
+    MEMCAT_OTHER = 0 ,
+    MEMCAT_VALUE ,      /* values and their text */
+    MEMCAT_TABLE ,      /* table maps */
+    MEMCAT_CODE ,       /* parsed and loaded nodes */
+    MEMCAT_EVAL ,       /* expression programs, caches and scratch */
+    MEMCAT_DUMP ,       /* persisted data buffers */
+    MEMCAT_COUNT
+};
 
-void* memalloc_zero( long  size );
+/*
+live and peak come from the allocator's own block sizes, a block from plain
+malloc has to be adopted before memfree takes it back
+*/
+typedef struct _MEM_STATS
+{
+    long long   live;
+    long long   peak;
+    long long   count[ MEMCAT_COUNT ];  /* allocations made */
+    long long   bytes[ MEMCAT_COUNT ];  /* bytes asked for */
+}
+MEM_STATS;
 
-void* memclone( void* ptr , long size );
+/* a source file defines this before its includes to charge its allocations */
+#ifndef MEMALLOC_CATEGORY
+    #define MEMALLOC_CATEGORY   MEMCAT_OTHER
+#endif
+
+#define memalloc( size )            memalloc_cat( size , MEMALLOC_CATEGORY )
+#define memalloc_zero( size )       memalloc_zero_cat( size , MEMALLOC_CATEGORY )
+#define memclone( ptr , size )      memclone_cat( ptr , size , MEMALLOC_CATEGORY )
+#define dup_str( str )              dup_str_cat( str , MEMALLOC_CATEGORY )
+
+void* memalloc_cat( long size , int category );
 
-char* dup_str( const char* str );
+void* memalloc_zero_cat( long size , int category );
+
+void* memclone_cat( void* ptr , long size , int category );
+
+char* dup_str_cat( const char* str , int category );
 
 void memfree( void* ptr );
 
+/* count a block from plain malloc that is freed here later */
+void memadopt( void* ptr , int category );
+
+void memstats_get( MEM_STATS* stats );
+
+/*
+stats also charged with every allocation and free from now on, NULL for
+none, returns the ones charged before
+*/
+MEM_STATS* memstats_charge( MEM_STATS* stats );
+
+long long memstats_live();
+
+const char* memstats_category_name( int category );
+
+/*
+size-class pool for small objects that are made and dropped all the time,
+blocks are carved from large slabs, kept on a free list per class when
+freed and all handed back at once by mempool_release, define
+MEMPOOL_MALLOC to get plain memalloc/memfree calls for debugging tools
+*/
+#define MEMPOOL_ALIGN       16
+#define MEMPOOL_CLASSES     8   /* 16, 32 .. 128 bytes */
+#define MEMPOOL_SLAB_SIZE   ( 16 * 1024 )
+
+typedef struct _MEMPOOL_SLAB    MEMPOOL_SLAB;
+
+struct _MEMPOOL_SLAB
+{
+    MEMPOOL_SLAB*   next;
+    long            align;
+};
+
+typedef struct _MEMPOOL_CLASS   MEMPOOL_CLASS;
+
+struct _MEMPOOL_CLASS
+{
+    void*           free;   /* linked through the first word of each block */
+    char*           next;   /* uncarved part of the newest slab */
+    char*           end;
+};
+
+typedef struct _MEM_POOL        MEM_POOL;
+
+struct _MEM_POOL
+{
+    MEMPOOL_CLASS   cls[MEMPOOL_CLASSES];
+    MEMPOOL_SLAB*   slab;
+    int             category;   /* MEM_CATEGORY the slabs are charged to */
+};
+
+void mempool_init( MEM_POOL* pool , int category );
+
+/* larger sizes go to memalloc, free with the same size */
+void* mempool_alloc( MEM_POOL* pool , long size );
+
+void* mempool_alloc_zero( MEM_POOL* pool , long size );
+
+void mempool_free( MEM_POOL* pool , void* ptr , long size );
+
+/* every block still out is freed with its slab */
+void mempool_release( MEM_POOL* pool );
+
 #endif
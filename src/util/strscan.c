@@ -0,0 +1,383 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#include <string.h>
+
+#if defined( __SSE2__ ) && ! defined( STRSCAN_NO_SIMD )
+    #define STRSCAN_SSE2
+    #include <emmintrin.h>
+#endif
+
+/* AVX2 code is built for a target attribute and only run when cpuid has it */
+#if defined( STRSCAN_SSE2 ) && defined( __GNUC__ ) \
+    && ( defined( __x86_64__ ) || defined( __i386__ ) )
+    #define STRSCAN_AVX2
+    #include <immintrin.h>
+#endif
+
+#include "strscan.h"
+
+#define SCAN_PLAIN          0
+#define SCAN_SSE2           1
+#define SCAN_AVX2           2
+
+#define SCAN_BYTE           0
+#define SCAN_SPACE          1
+#define SCAN_NONSPACE       2
+#define SCAN_NONASCII       3
+
+static int scan_level = -1;
+
+static int scan_detect( void )
+{
+#if defined( STRSCAN_AVX2 )
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return SCAN_AVX2;
+    }
+#endif
+#if defined( STRSCAN_SSE2 )
+    return SCAN_SSE2;
+#else
+    return SCAN_PLAIN;
+#endif
+}
+
+/* two threads may both detect, they store the same answer */
+static int scan_get_level( void )
+{
+    if ( scan_level < 0 )
+    {
+        scan_level = scan_detect();
+    }
+    
+    return scan_level;
+}
+
+static BOOL scan_hit( char b , int kind , char c )
+{
+    BOOL    space;
+    
+    if ( kind == SCAN_BYTE )
+    {
+        return b == c;
+    }
+    
+    if ( kind == SCAN_NONASCII )
+    {
+        return ( b & 0x80 ) != 0;
+    }
+    
+    space = ( b == ' ' ) || ( b == '\t' ) || ( b == '\n' ) || ( b == '\r' );
+    return ( kind == SCAN_SPACE ) ? space : ! space;
+}
+
+static int scan_plain( const char* buf , int len , int kind , char c )
+{
+    int     i;
+    
+    for ( i = 0; i < len; i++ )
+    {
+        if ( scan_hit( buf[i] , kind , c ) )
+        {
+            return i;
+        }
+    }
+    
+    return len;
+}
+
+static int find_plain( const char* buf , int len , const char* sep , int seplen )
+{
+    int     i;
+    
+    for ( i = 0; i + seplen <= len; i++ )
+    {
+        if ( ( buf[i] == sep[0] )
+            && ( memcmp( buf + i + 1 , sep + 1 , seplen - 1 ) == 0 ) )
+        {
+            return i;
+        }
+    }
+    
+    return len;
+}
+
+#if defined( STRSCAN_SSE2 )
+
+static unsigned int scan_lowbit( unsigned int bits )
+{
+#if defined( __GNUC__ )
+    return __builtin_ctz( bits );
+#else
+    unsigned int i = 0;
+    
+    while ( ( bits & 1 ) == 0 )
+    {
+        bits >>= 1;
+        i++;
+    }
+    
+    return i;
+#endif
+}
+
+static int scan_sse2( const char* buf , int len , int kind , char c )
+{
+    __m128i         block;
+    __m128i         hit;
+    unsigned int    bits;
+    int             i;
+    
+    for ( i = 0; i + 16 <= len; i += 16 )
+    {
+        block = _mm_loadu_si128( ( const __m128i* )( buf + i ) );
+        
+        if ( kind == SCAN_BYTE )
+        {
+            hit = _mm_cmpeq_epi8( block , _mm_set1_epi8( c ) );
+        }
+        else if ( kind == SCAN_NONASCII )
+        {
+            hit = block;    /* the mask takes the top bit of each byte */
+        }
+        else
+        {
+            hit = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_cmpeq_epi8( block , _mm_set1_epi8( ' ' ) ) ,
+                    _mm_cmpeq_epi8( block , _mm_set1_epi8( '\t' ) )
+                ) ,
+                _mm_or_si128(
+                    _mm_cmpeq_epi8( block , _mm_set1_epi8( '\n' ) ) ,
+                    _mm_cmpeq_epi8( block , _mm_set1_epi8( '\r' ) )
+                )
+            );
+        }
+        
+        bits = _mm_movemask_epi8( hit );
+        
+        if ( kind == SCAN_NONSPACE )
+        {
+            bits ^= 0xFFFF;
+        }
+        
+        if ( bits != 0 )
+        {
+            return i + scan_lowbit( bits );
+        }
+    }
+    
+    return i + scan_plain( buf + i , len - i , kind , c );
+}
+
+/*
+a block is only compared byte by byte at the offsets where both the first
+and the last byte of sep line up
+*/
+static int find_sse2( const char* buf , int len , const char* sep , int seplen )
+{
+    __m128i         first = _mm_set1_epi8( sep[0] );
+    __m128i         last = _mm_set1_epi8( sep[ seplen - 1 ] );
+    unsigned int    bits;
+    unsigned int    k;
+    int             i;
+    
+    for ( i = 0; i + seplen - 1 + 16 <= len; i += 16 )
+    {
+        bits = _mm_movemask_epi8( _mm_and_si128(
+            _mm_cmpeq_epi8(
+                _mm_loadu_si128( ( const __m128i* )( buf + i ) ) ,
+                first
+            ) ,
+            _mm_cmpeq_epi8(
+                _mm_loadu_si128( ( const __m128i* )( buf + i + seplen - 1 ) ) ,
+                last
+            )
+        ) );
+        
+        while ( bits != 0 )
+        {
+            k = scan_lowbit( bits );
+            
+            if ( memcmp( buf + i + k + 1 , sep + 1 , seplen - 2 ) == 0 )
+            {
+                return i + k;
+            }
+            
+            bits &= bits - 1;
+        }
+    }
+    
+    return i + find_plain( buf + i , len - i , sep , seplen );
+}
+
+#endif
+
+#if defined( STRSCAN_AVX2 )
+
+__attribute__(( target( "avx2" ) ))
+static int scan_avx2( const char* buf , int len , int kind , char c )
+{
+    __m256i         block;
+    __m256i         hit;
+    unsigned int    bits;
+    int             i;
+    
+    for ( i = 0; i + 32 <= len; i += 32 )
+    {
+        block = _mm256_loadu_si256( ( const __m256i* )( buf + i ) );
+        
+        if ( kind == SCAN_BYTE )
+        {
+            hit = _mm256_cmpeq_epi8( block , _mm256_set1_epi8( c ) );
+        }
+        else if ( kind == SCAN_NONASCII )
+        {
+            hit = block;
+        }
+        else
+        {
+            hit = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8( block , _mm256_set1_epi8( ' ' ) ) ,
+                    _mm256_cmpeq_epi8( block , _mm256_set1_epi8( '\t' ) )
+                ) ,
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8( block , _mm256_set1_epi8( '\n' ) ) ,
+                    _mm256_cmpeq_epi8( block , _mm256_set1_epi8( '\r' ) )
+                )
+            );
+        }
+        
+        bits = ( unsigned int )_mm256_movemask_epi8( hit );
+        
+        if ( kind == SCAN_NONSPACE )
+        {
+            bits = ~bits;
+        }
+        
+        if ( bits != 0 )
+        {
+            return i + scan_lowbit( bits );
+        }
+    }
+    
+    return i + scan_sse2( buf + i , len - i , kind , c );
+}
+
+__attribute__(( target( "avx2" ) ))
+static int find_avx2( const char* buf , int len , const char* sep , int seplen )
+{
+    __m256i         first = _mm256_set1_epi8( sep[0] );
+    __m256i         last = _mm256_set1_epi8( sep[ seplen - 1 ] );
+    unsigned int    bits;
+    unsigned int    k;
+    int             i;
+    
+    for ( i = 0; i + seplen - 1 + 32 <= len; i += 32 )
+    {
+        bits = ( unsigned int )_mm256_movemask_epi8( _mm256_and_si256(
+            _mm256_cmpeq_epi8(
+                _mm256_loadu_si256( ( const __m256i* )( buf + i ) ) ,
+                first
+            ) ,
+            _mm256_cmpeq_epi8(
+                _mm256_loadu_si256( ( const __m256i* )( buf + i + seplen - 1 ) ) ,
+                last
+            )
+        ) );
+        
+        while ( bits != 0 )
+        {
+            k = scan_lowbit( bits );
+            
+            if ( memcmp( buf + i + k + 1 , sep + 1 , seplen - 2 ) == 0 )
+            {
+                return i + k;
+            }
+            
+            bits &= bits - 1;
+        }
+    }
+    
+    return i + find_sse2( buf + i , len - i , sep , seplen );
+}
+
+#endif
+
+static int scan_class( const char* buf , int len , int kind , char c )
+{
+    switch ( scan_get_level() )
+    {
+#if defined( STRSCAN_AVX2 )
+    case SCAN_AVX2:
+        return scan_avx2( buf , len , kind , c );
+#endif
+#if defined( STRSCAN_SSE2 )
+    case SCAN_SSE2:
+        return scan_sse2( buf , len , kind , c );
+#endif
+    default:
+        return scan_plain( buf , len , kind , c );
+    }
+}
+
+int strscan_byte( const char* buf , int len , char c )
+{
+    return scan_class( buf , len , SCAN_BYTE , c );
+}
+
+int strscan_space( const char* buf , int len )
+{
+    return scan_class( buf , len , SCAN_SPACE , 0 );
+}
+
+int strscan_nonspace( const char* buf , int len )
+{
+    return scan_class( buf , len , SCAN_NONSPACE , 0 );
+}
+
+int strscan_nonascii( const char* buf , int len )
+{
+    return scan_class( buf , len , SCAN_NONASCII , 0 );
+}
+
+int strscan_find( const char* buf , int len , const char* sep , int seplen )
+{
+    if ( seplen <= 0 )
+    {
+        return len;
+    }
+    
+    if ( seplen == 1 )
+    {
+        return strscan_byte( buf , len , sep[0] );
+    }
+    
+    switch ( scan_get_level() )
+    {
+#if defined( STRSCAN_AVX2 )
+    case SCAN_AVX2:
+        return find_avx2( buf , len , sep , seplen );
+#endif
+#if defined( STRSCAN_SSE2 )
+    case SCAN_SSE2:
+        return find_sse2( buf , len , sep , seplen );
+#endif
+    default:
+        return find_plain( buf , len , sep , seplen );
+    }
+}
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2020, digmir <dev@digmir.com>
+ * 
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ * */
+
+#ifndef __UTIL_STRSCAN_H_INCLUDED__
+#define __UTIL_STRSCAN_H_INCLUDED__
+
+#include "stypes.h"
+
+/*
+byte scanners over a buffer of known length, a zero byte is data like any
+other; each returns the offset of the first match, or len when there is
+none
+
+16 or 32 bytes are compared at a time where the cpu has SSE2 or AVX2, the
+choice is made on the first call, build with STRSCAN_NO_SIMD to keep only
+the plain loops
+*/
+
+/* first c */
+int strscan_byte( const char* buf , int len , char c );
+
+/* first space, tab, line feed or carriage return */
+int strscan_space( const char* buf , int len );
+
+/* first byte that is none of those */
+int strscan_nonspace( const char* buf , int len );
+
+/* first byte above 0x7F, so the text before it is plain ASCII */
+int strscan_nonascii( const char* buf , int len );
+
+/* first occurrence of the seplen bytes at sep, len when seplen is 0 */
+int strscan_find( const char* buf , int len , const char* sep , int seplen );
+
+#endif